@@ -0,0 +1,112 @@
+/****************************************************************************
+  FileName  [ allocTrack.cpp ]
+  Synopsis  [ Counting replacements of the global operator new and delete. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.16 ]
+****************************************************************************/
+#ifdef FP_ALLOC_TRACK
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <atomic>
+#include <iomanip>
+#include "allocTrack.h"
+using namespace std;
+
+static atomic<size_t> allocNum(0);
+static atomic<size_t> allocBytes(0);
+
+// The scope records live in a fixed array, so that recording never
+// allocates by itself.
+struct ScopeRecord
+{
+    const char* _name;
+    size_t      _calls;
+    AllocStats  _stats;
+};
+static const size_t MAX_SCOPES = 64;
+static ScopeRecord scopes[MAX_SCOPES];
+static size_t scopeNum = 0;
+
+static void* countedAlloc(size_t size)
+{
+    allocNum.fetch_add(1, memory_order_relaxed);
+    allocBytes.fetch_add(size, memory_order_relaxed);
+    return malloc(size? size: 1);
+}
+
+void* operator new(size_t size)
+{
+    void* ptr = countedAlloc(size);
+    if (ptr == NULL)
+        throw bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept
+{
+    return countedAlloc(size);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept
+{
+    return countedAlloc(size);
+}
+
+void operator delete(void* ptr) noexcept                        { free(ptr); }
+void operator delete[](void* ptr) noexcept                      { free(ptr); }
+void operator delete(void* ptr, const nothrow_t&) noexcept      { free(ptr); }
+void operator delete[](void* ptr, const nothrow_t&) noexcept    { free(ptr); }
+
+AllocStats getAllocStats()
+{
+    AllocStats stats = { allocNum.load(memory_order_relaxed),
+                         allocBytes.load(memory_order_relaxed) };
+    return stats;
+}
+
+AllocScope::AllocScope(const char* name)
+{
+    for (_id = 0; _id < scopeNum; ++_id) {
+        if (scopes[_id]._name == name || strcmp(scopes[_id]._name, name) == 0)
+            break;
+    }
+    // too many scopes, the rest is added to the last one
+    if (_id == MAX_SCOPES)
+        _id = MAX_SCOPES - 1;
+    if (_id == scopeNum) {
+        scopes[_id]._name = name;
+        ++scopeNum;
+    }
+    ++scopes[_id]._calls;
+    _start = getAllocStats();
+}
+
+AllocScope::~AllocScope()
+{
+    AllocStats stats = getAllocStats();
+    scopes[_id]._stats._allocs += stats._allocs - _start._allocs;
+    scopes[_id]._stats._bytes += stats._bytes - _start._bytes;
+}
+
+void AllocScope::report(ostream& os)
+{
+    os << "Allocations by scope (callees included):" << endl;
+    for (size_t i = 0; i < scopeNum; ++i) {
+        const ScopeRecord& scope = scopes[i];
+        os << "  " << left << setw(28) << scope._name << right
+           << " calls " << setw(10) << scope._calls
+           << "  allocs/call " << setw(8) << fixed << setprecision(2)
+           << (double)scope._stats._allocs / scope._calls
+           << "  bytes/call " << setw(10) << (double)scope._stats._bytes / scope._calls << endl;
+    }
+    return;
+}
+
+#endif  // FP_ALLOC_TRACK
@@ -0,0 +1,52 @@
+/****************************************************************************
+  FileName  [ allocTrack.h ]
+  Synopsis  [ Count the heap allocations, built with -DFP_ALLOC_TRACK. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.16 ]
+****************************************************************************/
+#ifndef ALLOCTRACK_H
+#define ALLOCTRACK_H
+
+// With FP_ALLOC_TRACK (make ALLOC_TRACK=1), the global operator new and
+// delete are replaced by counting ones. ALLOC_SCOPE(name) then adds the
+// allocations made until the end of the enclosing block, callees included,
+// to the scope called name. Without it, ALLOC_SCOPE expands to nothing.
+#ifdef FP_ALLOC_TRACK
+
+#include <cstddef>
+#include <iostream>
+using namespace std;
+
+struct AllocStats
+{
+    size_t      _allocs;    // number of allocations
+    size_t      _bytes;     // bytes allocated
+};
+
+// allocations since the start of the program
+AllocStats getAllocStats();
+
+class AllocScope
+{
+public:
+    // name has to outlive the program, e.g. a string literal
+    AllocScope(const char* name);
+    ~AllocScope();
+
+    // calls and allocations of every scope so far
+    static void report(ostream& os);
+
+private:
+    size_t      _id;        // index of the scope record
+    AllocStats  _start;     // allocations when entering the scope
+};
+
+#define ALLOC_SCOPE(name) AllocScope allocScope_(name)
+
+#else
+
+#define ALLOC_SCOPE(name)
+
+#endif  // FP_ALLOC_TRACK
+
+#endif  // ALLOCTRACK_H
@@ -6,20 +6,27 @@
 ****************************************************************************/
 #include <iostream>
 #include <cassert>
+#include <climits>
+#include <unordered_map>
+#include <map>
+#include <algorithm>
 #include "bStarTree.h"
+#include "serialize.h"
+#include "allocTrack.h"
 
 // constructor and destructor
 BStarTree::BStarTree()
 {
     _root = NULL;
+    _hash = 0;
 }
 
 BStarTree::BStarTree(vector<Block*> blockList)
 {
-    _nodeList.push_back(new TNode(0));
+    this->addNode(new TNode(0));
     _root = _nodeList[0];
     for (size_t i = 1, end = blockList.size(); i < end; ++i) {
-        _nodeList.push_back(new TNode(i));
+        this->addNode(new TNode(i));
         if (i % 2 == 0) {
             _nodeList[i]->_parent = _nodeList[i/2-1];
             assert(_nodeList[i/2-1]->_right == NULL);
@@ -31,24 +38,215 @@ BStarTree::BStarTree(vector<Block*> blockList)
             _nodeList[i/2]->_left = _nodeList[i];
         }
     }
+    this->calcHash();
+}
+
+// The contour of a packing maps the x where each of its segments starts to
+// the height of the segment. It always has a segment at 0.
+typedef map<size_t, size_t> Contour;
+
+// the highest segment of the contour within [x1, x2)
+static size_t contourHeight(const Contour& contour, size_t x1, size_t x2)
+{
+    Contour::const_iterator it = contour.upper_bound(x1);
+    size_t height = 0;
+    for (--it; it != contour.end() && it->first < x2; ++it)
+        height = max(height, it->second);
+    return height;
+}
+
+// put a block on the contour within [x1, x2), its top at y
+static void raiseContour(Contour& contour, size_t x1, size_t x2, size_t y)
+{
+    Contour::iterator it = contour.upper_bound(x2);
+    size_t after = (--it)->second;
+    contour.erase(contour.lower_bound(x1), contour.upper_bound(x2));
+    contour[x1] = y;
+    contour[x2] = after;
+}
+
+// Rebuild a B*-tree from the positions currently stored in the blocks, e.g.
+// a previous result. Only blocks with placed[i] set have a valid position.
+// The packing is replayed in preorder: the left child of a block is the one
+// starting at its right boundary and the right child the one starting at its
+// x, each resting on the contour at the time it is packed, the lowest one if
+// several do. A placed block which rests on none of them, e.g. one on top of
+// a block removed from the circuit, then takes the first free child position
+// at its x in preorder, the lowest such block first, and drops onto the
+// contour when packed. Blocks left over (new blocks, or blocks of a
+// placement which was not packed from a B*-tree) are stacked on the block
+// packed last, so that the others keep their positions. The caller can tell
+// whether the tree packs the blocks where they were by packing it.
+BStarTree::BStarTree(vector<Block*> blockList, const vector<bool>& placed)
+{
+    size_t num = blockList.size();
+    vector<size_t> x1(num, 0), y1(num, 0), x2(num, 0), y2(num, 0);
+    map<size_t, vector<size_t> > column;      // blocks starting at the same x
+    vector<bool> assigned(num, false);
+    for (size_t i = 0; i < num; ++i) {
+        this->addNode(new TNode(i));
+        if (!placed[i])
+            continue;
+        Block* block = blockList[i];
+        x1[i] = block->getX1();     y1[i] = block->getY1();
+        x2[i] = block->getX2();     y2[i] = block->getY2();
+        // pick the orientation whose shape is closer to the placed one
+        size_t w = x2[i] - x1[i], h = y2[i] - y1[i];
+        size_t dOrigin = max(w, block->getWidth()) - min(w, block->getWidth()) +
+                         max(h, block->getHeight()) - min(h, block->getHeight());
+        size_t dRotate = max(w, block->getHeight()) - min(w, block->getHeight()) +
+                         max(h, block->getWidth()) - min(h, block->getWidth());
+        _nodeList[i]->_orient = (dRotate < dOrigin);
+        column[x1[i]].push_back(i);
+    }
+
+    // the root is the lowest block at the left boundary
+    _root = NULL;
+    for (size_t i = 0; i < num; ++i) {
+        if (placed[i] && (_root == NULL || x1[i] < x1[_root->_id] ||
+            (x1[i] == x1[_root->_id] && y1[i] < y1[_root->_id]))) {
+            _root = _nodeList[i];
+        }
+    }
+    if (_root == NULL) {
+        _root = _nodeList[0];
+    }
+    assigned[_root->_id] = true;
+
+    // <node> <whether its right child is due> of the children to be found,
+    // in packing order
+    Contour contour;
+    contour[0] = 0;
+    vector<pair<TNode*, bool> > stack;
+    if (placed[_root->_id]) {
+        raiseContour(contour, x1[_root->_id], x2[_root->_id], y2[_root->_id]);
+        stack.push_back(make_pair(_root, true));
+        stack.push_back(make_pair(_root, false));
+    }
+    while (!stack.empty()) {
+        TNode* node = stack.back().first;
+        bool right = stack.back().second;
+        stack.pop_back();
+        size_t i = node->_id;
+        map<size_t, vector<size_t> >::iterator it = column.find(right? x1[i]: x2[i]);
+        if (it == column.end())
+            continue;
+        size_t best = num;
+        for (size_t k = 0, end = it->second.size(); k < end; ++k) {
+            size_t j = it->second[k];
+            if (!assigned[j] && y1[j] == contourHeight(contour, x1[j], x2[j]) &&
+                (best == num || y1[j] < y1[best]))
+                best = j;
+        }
+        if (best == num)
+            continue;
+        TNode* child = _nodeList[best];
+        assigned[best] = true;
+        (right? node->_right: node->_left) = child;
+        child->_parent = node;
+        raiseContour(contour, x1[best], x2[best], y2[best]);
+        stack.push_back(make_pair(child, true));
+        stack.push_back(make_pair(child, false));
+    }
+
+    // the placed blocks left over go to the free positions at their x
+    vector<TNode*> nodes(1, _root);
+    while (!nodes.empty()) {
+        TNode* node = nodes.back();
+        nodes.pop_back();
+        size_t i = node->_id;
+        for (size_t r = 0; r < 2 && placed[i]; ++r) {
+            bool right = (r == 1);
+            if ((right? node->_right: node->_left) != NULL)
+                continue;
+            map<size_t, vector<size_t> >::iterator it = column.find(right? x1[i]: x2[i]);
+            if (it == column.end())
+                continue;
+            size_t best = num;
+            for (size_t k = 0, end = it->second.size(); k < end; ++k) {
+                size_t j = it->second[k];
+                if (!assigned[j] && (best == num || y1[j] < y1[best]))
+                    best = j;
+            }
+            if (best == num)
+                continue;
+            assigned[best] = true;
+            (right? node->_right: node->_left) = _nodeList[best];
+            _nodeList[best]->_parent = node;
+        }
+        if (node->_right != NULL)
+            nodes.push_back(node->_right);
+        if (node->_left != NULL)
+            nodes.push_back(node->_left);
+    }
+    // the block packed last is the last one in preorder
+    TNode* last = _root;
+    while (last->_left != NULL || last->_right != NULL)
+        last = (last->_right != NULL)? last->_right: last->_left;
+
+    // the block packed last is a leaf, the rest go on top of it
+    for (size_t i = 0; i < num; ++i) {
+        if (assigned[i])
+            continue;
+        last->_right = _nodeList[i];
+        _nodeList[i]->_parent = last;
+        last = _nodeList[i];
+        assigned[i] = true;
+    }
+    this->calcHash();
+}
+
+// Build a B*-tree of rows of blocks, from the bottom up and each row from
+// left to right. A block is the left child of the one before it in its row,
+// and the first block of a row is the right child of the first block of the
+// row below, so the packing drops every row onto the contour of the rows
+// below it. orient[i] is the orientation of block(i).
+BStarTree::BStarTree(const vector<vector<size_t> >& rows, const vector<bool>& orient)
+{
+    for (size_t i = 0, end = orient.size(); i < end; ++i) {
+        this->addNode(new TNode(i, orient[i]));
+    }
+    _root = NULL;
+    TNode* rowHead = NULL;
+    for (size_t r = 0, end = rows.size(); r < end; ++r) {
+        if (rows[r].empty())
+            continue;
+        TNode* node = _nodeList[rows[r][0]];
+        if (rowHead == NULL) {
+            _root = node;
+        }
+        else {
+            rowHead->_right = node;
+            node->_parent = rowHead;
+        }
+        rowHead = node;
+        for (size_t k = 1, n = rows[r].size(); k < n; ++k) {
+            TNode* next = _nodeList[rows[r][k]];
+            node->_left = next;
+            next->_parent = node;
+            node = next;
+        }
+    }
+    assert(_root != NULL);
+    this->calcHash();
 }
 
 BStarTree::BStarTree(const BStarTree& tree)
 {
-    this->clear();
-    _nodeList.push_back(new TNode(tree._root->_id, tree._root->_orient));
-    _root = _nodeList[0];
-    this->copyTree(&(_root->_left), tree._root->_left, _root);
-    this->copyTree(&(_root->_right), tree._root->_right, _root);
+    _root = NULL;
+    _nodeList.reserve(tree._nodeList.size());
+    this->copyTree(&_root, tree._root, NULL);
+    _hash = tree._hash;
 }
 
 BStarTree& BStarTree::operator = (const BStarTree& tree)
 {
     this->clear();
-    _nodeList.push_back(new TNode(tree._root->_id, tree._root->_orient));
-    _root = _nodeList[0];
-    this->copyTree(&(_root->_left), tree._root->_left, _root);
-    this->copyTree(&(_root->_right), tree._root->_right, _root);
+    _root = NULL;
+    _nodeList.reserve(tree._nodeList.size());
+    this->copyTree(&_root, tree._root, NULL);
+    _hash = tree._hash;
+    return *this;
 }
 
 BStarTree::~BStarTree()
@@ -57,32 +255,303 @@ BStarTree::~BStarTree()
 }
 
 // member functions
-vector<BStarTree> BStarTree::perturb()
+vector<BStarTree> BStarTree::perturb(MoveContext& ctx)
 {
+    ALLOC_SCOPE("BStarTree::perturb");
     vector<BStarTree> trees;
-    size_t r = rand() % 10;
-    if (r < 2) {
-        this->rotate(trees);
+    for (size_t tries = 1; trees.empty(); ++tries) {
+        bool filter = (tries < MAX_PERTURB_TRIES);
+        if (ctx._selector != NULL) {
+            ctx._move = ctx._selector->select(*ctx._rng);
+        }
+        else {
+            size_t r = (*ctx._rng)(10);
+            ctx._move = (r < 2)? ROTATE: (r < 6)? SWAP_ROTATED: MOVE_ROTATED;
+        }
+        switch (ctx._move) {
+            case ROTATE:
+                this->rotate(trees, ctx, filter);
+                break;
+            case SWAP:
+            case SWAP_ROTATED:
+                this->swap(trees, ctx, ctx._move == SWAP_ROTATED, filter);
+                break;
+            default:
+                this->delAndInsert(trees, ctx, ctx._move == MOVE_ROTATED, filter);
+                break;
+        }
     }
-    else if (r < 6) {
-        this->swap(trees);
+    return trees;
+}
+
+// nodes on either side of a leaf in _nodeList it may be moved under by the
+// greedy compaction
+static const size_t LOCAL_WINDOW = 16;
+
+// Local moves of the greedy compaction, by index k:
+// [0, n)          rotate node k
+// [n, 2n)         swap node k - n with its parent
+// [2n, 2n + 4wn)  move a leaf to a free left/right child position of one of
+//                 the w = LOCAL_WINDOW nodes before or after it in _nodeList
+// The nodes of an annealed tree are in preorder, i.e. in packing order, so the
+// targets are near the leaf, and a pass tries O(n) moves instead of O(n^2).
+size_t BStarTree::getLocalMoveNum() const
+{
+    size_t n = _nodeList.size();
+    return 2 * n + 4 * LOCAL_WINDOW * n;
+}
+
+size_t BStarTree::applyLocalMove(size_t k)
+{
+    size_t n = _nodeList.size();
+    if (k < n) {
+        this->rotateNode(k);
+        return 0;
+    }
+    if (k < 2 * n) {
+        TNode* node = _nodeList[k - n];
+        if (node->_parent == NULL)
+            return NO_LOCAL_MOVE;
+        this->swapNodes(k - n, node->_parent->_index);
+        return 0;
+    }
+    k -= 2 * n;
+    bool right = k % 2;
+    size_t i = (k / 2) / (2 * LOCAL_WINDOW), d = (k / 2) % (2 * LOCAL_WINDOW);
+    // d in [0, w) is a node before the leaf, d in [w, 2w) one after it
+    if (d < LOCAL_WINDOW && i < LOCAL_WINDOW - d)
+        return NO_LOCAL_MOVE;
+    size_t j = (d < LOCAL_WINDOW)? i - (LOCAL_WINDOW - d): i + (d - LOCAL_WINDOW + 1);
+    if (j >= n)
+        return NO_LOCAL_MOVE;
+    TNode* node = _nodeList[i];
+    TNode* target = _nodeList[j];
+    if (node->_parent == NULL || node->_left != NULL || node->_right != NULL)
+        return NO_LOCAL_MOVE;
+    if ((right? target->_right: target->_left) != NULL)
+        return NO_LOCAL_MOVE;
+    // remember where the leaf was
+    size_t undo = node->_parent->_index * 2 + (node->_parent->_right == node);
+    this->deleteNode(i);
+    this->insertNode(i, j, right, false);
+    return undo;
+}
+
+void BStarTree::undoLocalMove(size_t k, size_t undo)
+{
+    size_t n = _nodeList.size();
+    if (k < n) {
+        this->rotateNode(k);
+    }
+    else if (k < 2 * n) {
+        // the tree is unchanged, only the blocks of the two nodes are swapped
+        this->swapNodes(k - n, _nodeList[k - n]->_parent->_index);
     }
     else {
-        this->delAndInsert(trees);
+        size_t i = ((k - 2 * n) / 2) / (2 * LOCAL_WINDOW);
+        this->deleteNode(i);
+        this->insertNode(i, undo / 2, undo % 2, false);
     }
-    return trees;
+    return;
+}
+
+void BStarTree::pack(vector<Block*>& blockList)
+{
+    ALLOC_SCOPE("BStarTree::pack");
+    _contourList.clear();
+    _contourList.push_back(new LNode());
+    _contourList.back()->setPos(0, 0);
+    _contourList.push_back(new LNode());
+    _contourList.back()->setPos(INT_MAX, 0);
+    LNode* head = _contourList[0];
+    head->insertNext(_contourList[1]);
+    Block::setMaxX(0);
+    Block::setMaxY(0);
+    this->packBlock(blockList, _root, head);
+    for (size_t i = 0, end = _contourList.size(); i < end; ++i) {
+        delete _contourList[i];
+    }
+    _contourList.clear();
+    return;
+}
+
+// The nodes are written in the order of _nodeList, so that a restored tree
+// picks the same nodes as the original one for the same random numbers.
+// <#nodes> <root index> { <block id> <orient> <parent> <left> <right> }
+void BStarTree::write(ostream& os) const
+{
+    unordered_map<const TNode*, int32_t> index;
+    index[NULL] = -1;
+    for (size_t i = 0, end = _nodeList.size(); i < end; ++i) {
+        index[_nodeList[i]] = i;
+    }
+    writeBinary<uint32_t>(os, _nodeList.size());
+    writeBinary<int32_t>(os, index[_root]);
+    for (size_t i = 0, end = _nodeList.size(); i < end; ++i) {
+        const TNode* node = _nodeList[i];
+        writeBinary<uint32_t>(os, node->_id);
+        writeBinary<uint8_t>(os, node->_orient);
+        writeBinary<int32_t>(os, index[node->_parent]);
+        writeBinary<int32_t>(os, index[node->_left]);
+        writeBinary<int32_t>(os, index[node->_right]);
+    }
+    return;
+}
+
+// The tree must hold every block once, with the parent and child links
+// agreeing and every node reachable from the root.
+bool BStarTree::read(istream& is, size_t blockNum)
+{
+    uint32_t num;
+    int32_t root;
+    this->clear();
+    _root = NULL;
+    if (!readBinary(is, num) || !readBinary(is, root) || num == 0 || num != blockNum)
+        return false;
+    if (root < 0 || root >= (int32_t)num)
+        return false;
+    for (size_t i = 0; i < num; ++i) {
+        this->addNode(new TNode(0));
+    }
+    vector<bool> seen(num, false);
+    for (size_t i = 0; i < num; ++i) {
+        uint32_t id;
+        uint8_t orient;
+        int32_t link[3];
+        if (!readBinary(is, id) || !readBinary(is, orient) || id >= num || seen[id])
+            return false;
+        seen[id] = true;
+        for (size_t j = 0; j < 3; ++j) {
+            if (!readBinary(is, link[j]) || link[j] < -1 || link[j] >= (int32_t)num)
+                return false;
+        }
+        TNode* node = _nodeList[i];
+        node->_id = id;
+        node->_orient = orient;
+        node->_parent = (link[0] < 0)? NULL: _nodeList[link[0]];
+        node->_left = (link[1] < 0)? NULL: _nodeList[link[1]];
+        node->_right = (link[2] < 0)? NULL: _nodeList[link[2]];
+    }
+    _root = _nodeList[root];
+    if (_root->_parent != NULL)
+        return false;
+    for (size_t i = 0; i < num; ++i) {
+        TNode* node = _nodeList[i];
+        if (node->_left != NULL && node->_left->_parent != node)
+            return false;
+        if (node->_right != NULL && node->_right->_parent != node)
+            return false;
+        if (node != _root && node->_parent == NULL)
+            return false;
+    }
+    // the links agree, so only a cycle apart from the root can hide nodes
+    size_t reached = 0;
+    vector<TNode*> stack(1, _root);
+    while (!stack.empty()) {
+        TNode* node = stack.back();
+        stack.pop_back();
+        if (++reached > num)
+            return false;
+        if (node->_left != NULL)
+            stack.push_back(node->_left);
+        if (node->_right != NULL)
+            stack.push_back(node->_right);
+    }
+    if (reached != num)
+        return false;
+    this->calcHash();
+    return true;
 }
 
 
 // private member functions
+int BStarTree::findNode(size_t blockId) const
+{
+    for (size_t i = 0, end = _nodeList.size(); i < end; ++i) {
+        if (_nodeList[i]->_id == blockId)
+            return i;
+    }
+    assert(0);
+    return -1;
+}
+
+void BStarTree::addNode(TNode* node)
+{
+    node->_index = _nodeList.size();
+    _nodeList.push_back(node);
+    return;
+}
+
+// Pack the subtree of node in preorder. A node is placed on the contour
+// starting at head, its left child on the contour right after it and its
+// right child on head again. The pending right children wait on an explicit
+// stack, so a degenerated tree of many blocks does not overflow the call
+// stack.
+void BStarTree::packBlock(vector<Block*>& blockList, TNode* node, LNode* head)
+{
+    vector<pair<TNode*, LNode*> > stack;
+    stack.reserve(_nodeList.size());
+    stack.push_back(make_pair(node, head));
+    while (!stack.empty()) {
+        node = stack.back().first;
+        head = stack.back().second;
+        stack.pop_back();
+        Block* block = blockList[node->getId()];
+        size_t x = head->_x;
+        size_t prevY = head->_y, maxY = head->_y;
+        size_t width = block->getWidth(node->getOrient());
+        size_t height = block->getHeight(node->getOrient());
+        while (x + width > head->_next->_x) {
+            prevY = head->_next->_y;
+            maxY = (maxY > prevY)? maxY: prevY;
+            head->deleteNext();
+        }
+        block->setPos(x, maxY, x + width, maxY + height);
+        if (x + width > Block::getMaxX())
+            Block::setMaxX(x + width);
+        if (maxY + height > Block::getMaxY())
+            Block::setMaxY(maxY + height);
+        head->_y = maxY + height;
+        if (x + width < head->_next->_x) {
+            _contourList.push_back(new LNode());
+            _contourList.back()->setPos(x + width, prevY);
+            head->insertNext(_contourList.back());
+        }
+        if (node->_right != NULL)
+            stack.push_back(make_pair(node->_right, head));
+        if (node->_left != NULL)
+            stack.push_back(make_pair(node->_left, head->_next));
+    }
+    return;
+}
+
+// Copy the subtree of cNode to *nodePtr under prev. The nodes are appended
+// to _nodeList in preorder, the left subtree before the right one, with an
+// explicit stack instead of recursion.
 void BStarTree::copyTree(TNode** nodePtr, const TNode* cNode, TNode* prev)
 {
-    if (cNode != NULL) {
-        _nodeList.push_back(new TNode(cNode->_id, cNode->_orient));
-        *nodePtr = _nodeList.back();
-        _nodeList.back()->_parent = prev;
-        this->copyTree(&(_nodeList.back()->_left), cNode->_left, _nodeList.back());
-        this->copyTree(&(_nodeList.back()->_right), cNode->_right, _nodeList.back());
+    struct Pending
+    {
+        TNode**         _nodePtr;   // where the copy is linked
+        const TNode*    _cNode;     // node to be copied
+        TNode*          _prev;      // parent of the copy
+    };
+    vector<Pending> stack;
+    Pending first = { nodePtr, cNode, prev };
+    stack.push_back(first);
+    while (!stack.empty()) {
+        Pending cur = stack.back();
+        stack.pop_back();
+        if (cur._cNode == NULL)
+            continue;
+        TNode* node = new TNode(cur._cNode->_id, cur._cNode->_orient);
+        this->addNode(node);
+        *cur._nodePtr = node;
+        node->_parent = cur._prev;
+        Pending right = { &(node->_right), cur._cNode->_right, node };
+        Pending left = { &(node->_left), cur._cNode->_left, node };
+        stack.push_back(right);
+        stack.push_back(left);
     }
     return;
 }
@@ -96,24 +565,69 @@ void BStarTree::clear()
     return;
 }
 
-void BStarTree::rotate(vector<BStarTree>& trees)
+// The key of a node covers its block, its orientation, the block of its parent
+// and which child it is, so the XOR over all nodes identifies the tree. A
+// move changes the keys of a few nodes only, which are toggled out of the
+// hash before and back in after the move.
+uint64_t BStarTree::nodeKey(const TNode* node) const
+{
+    uint64_t parent = (node->_parent == NULL)? 0xffffffffULL: node->_parent->_id;
+    uint64_t right = (node->_parent != NULL && node->_parent->_right == node);
+    return mix64(((uint64_t)node->_id << 34) ^ (parent << 2) ^ (right << 1) ^ node->_orient);
+}
+
+void BStarTree::calcHash()
+{
+    _hash = 0;
+    for (size_t i = 0, end = _nodeList.size(); i < end; ++i) {
+        _hash ^= this->nodeKey(_nodeList[i]);
+    }
+    return;
+}
+
+// XOR the keys of the distinct non-NULL nodes into the hash
+void BStarTree::toggleHash(TNode* const* nodes, size_t num)
+{
+    for (size_t i = 0; i < num; ++i) {
+        if (nodes[i] == NULL || find(nodes, nodes + i, nodes[i]) != nodes + i)
+            continue;
+        _hash ^= this->nodeKey(nodes[i]);
+    }
+    return;
+}
+
+void BStarTree::rotate(vector<BStarTree>& trees, MoveContext& ctx, bool filter)
 {
+    int id = this->pickNode(ctx);
+    if (filter && ctx.isSquare(_nodeList[id]->_id))
+        return;
     trees.push_back(*(this));
-    int id = rand() % _nodeList.size();
     trees.back().rotateNode(id);
     // cout << "Rotate " << id << endl;
     return;
 }
 
-void BStarTree::swap(vector<BStarTree>& trees)
+// Rotating a square block before the swap gives the candidate without the
+// rotation again, and swapping two alike blocks of the same orientation gives
+// this tree again.
+void BStarTree::swap(vector<BStarTree>& trees, MoveContext& ctx, bool rotated, bool filter)
 {
     int id1 = 0, id2 = 0;
     while (id1 == id2) {
-        id1 = rand() % _nodeList.size();
-        id2 = rand() % _nodeList.size();
+        id1 = this->pickNode(ctx);
+        id2 = this->pickNear(ctx, id1);
     }
-    for (size_t i = 0; i < 2; ++i) {
-        for (size_t j = 0; j < 2; ++j) {
+    TNode* node1 = _nodeList[id1];
+    TNode* node2 = _nodeList[id2];
+    bool square1 = filter && ctx.isSquare(node1->_id);
+    bool square2 = filter && ctx.isSquare(node2->_id);
+    bool alike = filter && ctx.isAlike(node1->_id, node2->_id) &&
+                 (node1->_orient == node2->_orient || square1);
+    size_t n = rotated? 2: 1;
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            if ((i == 1 && square1) || (j == 1 && square2) || (i == 0 && j == 0 && alike))
+                continue;
             trees.push_back(*(this));
             if (i == 1)
                 trees.back().rotateNode(id1);
@@ -126,14 +640,18 @@ void BStarTree::swap(vector<BStarTree>& trees)
     return;
 }
 
-void BStarTree::delAndInsert(vector<BStarTree>& trees)
+// Inserting a node where no child is pushed aside, or right back where it
+// was, repeats another candidate or this tree, which the hash tells.
+void BStarTree::delAndInsert(vector<BStarTree>& trees, MoveContext& ctx, bool rotated, bool filter)
 {
     int id1 = 0, id2 = 0;
     while (id1 == id2) {
-        id1 = rand() % _nodeList.size();
-        id2 = rand() % _nodeList.size();
+        id1 = this->pickNode(ctx);
+        id2 = this->pickNear(ctx, id1);
     }
-    for (size_t i = 0; i < 2; ++i) {
+    bool square1 = filter && ctx.isSquare(_nodeList[id1]->_id);
+    size_t n = (rotated && !square1)? 2: 1;
+    for (size_t i = 0; i < n; ++i) {
         for (size_t j = 0; j < 2; ++j) {
             for (size_t k = 0; k < 2; ++k) {
                 trees.push_back(*(this));
@@ -141,6 +659,8 @@ void BStarTree::delAndInsert(vector<BStarTree>& trees)
                     trees.back().rotateNode(id1);
                 trees.back().deleteNode(id1);
                 trees.back().insertNode(id1, id2, j, k);
+                if (filter && this->isDuplicate(trees))
+                    trees.pop_back();
             }
         }
     }
@@ -148,10 +668,51 @@ void BStarTree::delAndInsert(vector<BStarTree>& trees)
     return;
 }
 
+// whether the last of the trees equals this tree or an earlier candidate
+bool BStarTree::isDuplicate(const vector<BStarTree>& trees) const
+{
+    uint64_t hash = trees.back()._hash;
+    if (hash == _hash)
+        return true;
+    for (size_t i = 0, end = trees.size() - 1; i < end; ++i) {
+        if (trees[i]._hash == hash)
+            return true;
+    }
+    return false;
+}
+
+// Pick the node to be moved. Half of the picks go to the blocks sticking
+// out of the outline, if any.
+int BStarTree::pickNode(MoveContext& ctx)
+{
+    Rng& rng = *ctx._rng;
+    if (!ctx._hot.empty() && rng(2) == 0)
+        return this->findNode(ctx._hot[rng(ctx._hot.size())]);
+    return rng(_nodeList.size());
+}
+
+// Pick the partner of node(id) within ctx._window of the nodes around it.
+// The nodes of a copied tree are in preorder, i.e. in packing order, so
+// close nodes are usually close blocks and the move changes the packing
+// of a short range only.
+int BStarTree::pickNear(MoveContext& ctx, int id)
+{
+    Rng& rng = *ctx._rng;
+    int num = _nodeList.size();
+    if (ctx._window >= 1)
+        return rng(num);
+    int w = max(1, (int)(ctx._window * num));
+    int lo = max(0, id - w), hi = min(num - 1, id + w);
+    return lo + rng(hi - lo + 1);
+}
+
 void BStarTree::swapNodes(int id1, int id2)
 {
     TNode* node1 = _nodeList[id1];
     TNode* node2 = _nodeList[id2];
+    // the children refer to the blocks of their parents
+    TNode* touched[6] = { node1, node2, node1->_left, node1->_right, node2->_left, node2->_right };
+    this->toggleHash(touched, 6);
     int b_id1 = node1->getId();
     int b_id2 = node2->getId();
     bool orient1 = node1->getOrient();
@@ -160,13 +721,16 @@ void BStarTree::swapNodes(int id1, int id2)
     node2->setId(b_id1);
     node1->setOrient(orient2);
     node2->setOrient(orient1);
+    this->toggleHash(touched, 6);
 
     return;
 }
 
 void BStarTree::rotateNode(int id)
 {
+    _hash ^= this->nodeKey(_nodeList[id]);
     _nodeList[id]->rotate();
+    _hash ^= this->nodeKey(_nodeList[id]);
     return;
 }
 
@@ -174,6 +738,14 @@ void BStarTree::deleteNode(int id)
 {
     TNode* node = _nodeList[id];
     while (true) {
+        // the keys of these nodes change in this step, the deleted node is
+        // hashed as a root until it is inserted again
+        TNode* touched[5] = { node, node->_left, node->_right, NULL, NULL };
+        if (node->_left != NULL && node->_right != NULL) {
+            touched[3] = node->_left->_left;
+            touched[4] = node->_left->_right;
+        }
+        this->toggleHash(touched, 5);
         if (node != _root) {
             if (node->_left == NULL && node->_right == NULL) {
                 if (node->_parent->_left == node) {
@@ -186,6 +758,7 @@ void BStarTree::deleteNode(int id)
                     assert(0);
                 }
                 node->_parent = NULL;
+                this->toggleHash(touched, 5);
                 break;
             }
             else if (node->_left == NULL) {
@@ -201,6 +774,7 @@ void BStarTree::deleteNode(int id)
                 }
                 node->_parent = NULL;
                 node->_right = NULL;
+                this->toggleHash(touched, 5);
                 break;
             }
             else if (node->_right == NULL) {
@@ -216,6 +790,7 @@ void BStarTree::deleteNode(int id)
                 }
                 node->_parent = NULL;
                 node->_left = NULL;
+                this->toggleHash(touched, 5);
                 break;
             }
             else {
@@ -256,6 +831,7 @@ void BStarTree::deleteNode(int id)
                 assert(node->_right->_parent == NULL);
                 _root = node->_right;
                 node->_right = NULL;
+                this->toggleHash(touched, 5);
                 break;
             }
             else if (node->_right == NULL) {
@@ -263,6 +839,7 @@ void BStarTree::deleteNode(int id)
                 assert(node->_left->_parent == NULL);
                 _root = node->_left;
                 node->_left = NULL;
+                this->toggleHash(touched, 5);
                 break;
             }
             else {
@@ -284,6 +861,7 @@ void BStarTree::deleteNode(int id)
                 _root = l;
             }
         }
+        this->toggleHash(touched, 5);
     }
     return;
 }
@@ -296,6 +874,8 @@ void BStarTree::insertNode(int id1, int id2, bool p_right, bool n_right)
     TNode* node1 = _nodeList[id1];
     TNode* node2 = _nodeList[id2];
     assert(node1->_parent == NULL && node1->_left == NULL && node1->_right == NULL);
+    TNode* touched[2] = { node1, p_right? node2->_right: node2->_left };
+    this->toggleHash(touched, 2);
 
     if (p_right) {
         TNode* r = node2->_right;
@@ -319,5 +899,6 @@ void BStarTree::insertNode(int id1, int id2, bool p_right, bool n_right)
         if (l != NULL)
             l->_parent = node1;
     }
+    this->toggleHash(touched, 2);
     return;
 }
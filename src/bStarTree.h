@@ -8,19 +8,51 @@
 #define BSTARTREE_H
 
 #include <vector>
+#include <iostream>
 #include "module.h"
+#include "rng.h"
+#include "representation.h"
 using namespace std;
 
+// Linked list node of the contour
+class LNode
+{
+    friend class BStarTree;
+
+private:
+    // constructor and destructor
+    LNode(LNode* next = NULL) :
+        _next(next) { }
+    ~LNode()    { }
+
+    void setPos(size_t x, size_t y) {
+        _x = x; _y = y;
+    }
+
+    void insertNext(LNode* node) {
+        LNode* n = _next;
+        _next = node;
+        node->_next = n;
+    }
+
+    void deleteNext() {
+        _next = _next->_next;
+    }
+
+    LNode*      _next;      // next linked list node
+    size_t      _x;         // coordinate x
+    size_t      _y;         // coordinate y
+};
+
 // B*-tree node
 class TNode
 {
     friend class BStarTree;
-    friend class Floorplanner;
 
 public:
     // constructor and destructor
     TNode(size_t id, bool orient = false, TNode* p = NULL, TNode* l = NULL, TNode* r = NULL) :
-        _id(id), _orient(orient), _parent(p), _left(l), _right(r) { }
+        _id(id), _orient(orient), _index(0), _parent(p), _left(l), _right(r) { }
     ~TNode()    { }
 
     // basic access methods
@@ -35,39 +67,72 @@ public:
 private:
     size_t      _id;        // id of the block storing in this node
     bool        _orient;    // record the orientation of the block (0: origin, 1: rotated)
+    size_t      _index;     // position of the node in the _nodeList of its tree
     TNode*      _parent;    // parent of the node
     TNode*      _left;      // left child of the node
     TNode*      _right;     // right child of the node
 };
 
 
-class BStarTree
+class BStarTree : public Representation
 {
-    friend class Floorplanner;
-
 public:
+    // move types of perturb(), the *_ROTATED ones also try the rotations
+    // of the moved blocks
+    enum Move { ROTATE, SWAP, SWAP_ROTATED, MOVE, MOVE_ROTATED };
+    static const size_t MOVE_NUM = 5;
+
     // constructor and destructor
     BStarTree();
     BStarTree(vector<Block*> blockList);
+    BStarTree(vector<Block*> blockList, const vector<bool>& placed);
+    BStarTree(const vector<vector<size_t> >& rows, const vector<bool>& orient);
     BStarTree(const BStarTree& tree);
     BStarTree& operator = (const BStarTree& tree);
     ~BStarTree();
 
     // perturbing the B*-tree
-    vector<BStarTree> perturb();
+    vector<BStarTree> perturb(MoveContext& ctx);
+
+    // local moves for the greedy compaction
+    size_t getLocalMoveNum() const;
+    size_t applyLocalMove(size_t k);
+    void undoLocalMove(size_t k, size_t undo);
+
+    // packing the blocks with a contour
+    void pack(vector<Block*>& blockList);
+
+    // Zobrist-style hash of the topology, block ids and orientations, equal
+    // for the trees packing the same way
+    uint64_t getHash() const    { return _hash; }
+
+    // saving and restoring the B*-tree (topology and orientations)
+    void write(ostream& os) const;
+    bool read(istream& is, size_t blockNum);
 
 private:
     TNode*          _root;          // root of the B*-tree
     vector<TNode*>  _nodeList;      // list of nodes in the tree
+    vector<LNode*>  _contourList;   // list of contour nodes while packing
+    uint64_t        _hash;          // XOR of the keys of all nodes, see nodeKey()
 
     // private member functions
+    int  findNode(size_t blockId) const;
+    void addNode(TNode* node);
+    void packBlock(vector<Block*>& blockList, TNode* node, LNode* head);
     void copyTree(TNode** nodePtr, const TNode* cNode, TNode* prev);
     void clear();
+    uint64_t nodeKey(const TNode* node) const;
+    void calcHash();
+    void toggleHash(TNode* const* nodes, size_t num);
 
     // manipulating the B*-tree to get the "neighborhood structures"
-    void rotate(vector<BStarTree>& trees);
-    void swap(vector<BStarTree>& trees);
-    void delAndInsert(vector<BStarTree>& trees);
+    void rotate(vector<BStarTree>& trees, MoveContext& ctx, bool filter);
+    void swap(vector<BStarTree>& trees, MoveContext& ctx, bool rotated, bool filter);
+    void delAndInsert(vector<BStarTree>& trees, MoveContext& ctx, bool rotated, bool filter);
+    bool isDuplicate(const vector<BStarTree>& trees) const;
+    int  pickNode(MoveContext& ctx);
+    int  pickNear(MoveContext& ctx, int id);
 
     // manipulating the nodes
     void swapNodes(int id1, int id2);
@@ -0,0 +1,458 @@
+/****************************************************************************
+  FileName  [ bench.cpp ]
+  Synopsis  [ Benchmark of the floorplanner over seeds and time budgets. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.14 ]
+****************************************************************************/
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstdlib>
+#include "floorplanner.h"
+using namespace std;
+
+// Every testcase is floorplanned once per seed with the largest budget as
+// its time limit. The costs at the smaller budgets are read from the trace
+// of the best-so-far cost, so one run serves all budgets.
+//
+// <prefix>.runs.csv    one row per run, the input of --compare
+// <prefix>.trace.csv   best-so-far cost over wall time of every run
+// <prefix>.json        median and p90 of time-to-fit and cost-at-budget
+
+struct BenchRun
+{
+    string          _name;      // testcase
+    size_t          _seed;
+    size_t          _trials;    // annealing runs started
+    double          _timeToFit; // wall seconds to the first fitting floorplan
+    vector<double>  _costs;     // best reported cost at each budget
+    double          _allocs;    // allocations per move, -1 if not tracked
+    vector<TracePoint> _trace;
+};
+
+// swallows the output of the floorplanner unless --verbose
+class NullBuffer : public streambuf
+{
+protected:
+    int overflow(int c) { return c; }
+};
+
+static const double INF = HUGE_VAL;
+
+void usage()
+{
+    cerr << "Usage: ./FloorplanBench [options] <testcase> ..." << endl;
+    cerr << "       ./FloorplanBench --compare <a.runs.csv> <b.runs.csv>" << endl;
+    cerr << "A testcase is a path without extension, e.g. testcase/ami33 for" << endl;
+    cerr << "testcase/ami33.block and testcase/ami33.nets." << endl;
+    cerr << "Options:" << endl;
+    cerr << "  --seeds <n>                  run seeds 1 to n (default 10)" << endl;
+    cerr << "  --budgets <sec,sec,...>      wall time budgets (default 1,2,5,10)" << endl;
+    cerr << "  --alpha <alpha>              cost weight of area (default 0.5)" << endl;
+    cerr << "  --out <prefix>               prefix of the output files (default bench)" << endl;
+    cerr << "  --verbose                    show the output of the floorplanner" << endl;
+    cerr << "  --alloc-limit <n>            fail if a run allocates more than n times per move" << endl;
+    cerr << "                               (only in a build with ALLOC_TRACK=1)" << endl;
+    cerr << "  --engine, --cost, --speculate, --init, --targeted-moves, --windowed-moves," << endl;
+    cerr << "  --adaptive-moves" << endl;
+    cerr << "                               passed to the floorplanner" << endl;
+    exit(1);
+}
+
+// nearest rank, inf (not fit) counts as the largest value
+double percentile(vector<double> values, double p)
+{
+    if (values.empty())
+        return INF;
+    sort(values.begin(), values.end());
+    size_t rank = (size_t)ceil(p * values.size());
+    return values[(rank > 0)? rank - 1: 0];
+}
+
+string toCSV(double value)
+{
+    if (value == INF)
+        return "inf";
+    stringstream ss;
+    ss << setprecision(10) << value;
+    return ss.str();
+}
+
+string toJSON(double value)
+{
+    return (value == INF)? "null": toCSV(value);
+}
+
+double fromCSV(const string& str)
+{
+    return (str == "inf")? INF: stod(str);
+}
+
+vector<string> split(const string& str, char delim)
+{
+    vector<string> tokens;
+    stringstream ss(str);
+    string token;
+    while (getline(ss, token, delim))
+        tokens.push_back(token);
+    return tokens;
+}
+
+BenchRun runCase(const string& path, size_t seed, const vector<double>& budgets,
+                 double alpha, const vector<string>& options, bool verbose)
+{
+    fstream inBlk((path + ".block").c_str(), ios::in);
+    fstream inNet((path + ".nets").c_str(), ios::in);
+    if (!inBlk || !inNet) {
+        cerr << "Cannot open the testcase \"" << path
+             << "\". The program will be terminated..." << endl;
+        exit(1);
+    }
+    NullBuffer null;
+    streambuf* coutBuf = cout.rdbuf();
+    if (!verbose)
+        cout.rdbuf(&null);
+
+    Floorplanner fp(inBlk, inNet);
+    fp.setAlpha(alpha);
+    fp.setSeed(seed);
+    fp.setTimeLimit(budgets.back());
+    fp.setTracing(true);
+    // the drawing would be timed with the annealing
+    fp.setDrawFormat("none");
+    bool constructive = false;
+    for (size_t i = 0, end = options.size(); i < end; ++i) {
+        if (options[i] == "--engine")
+            fp.setEngine(options[++i]);
+        else if (options[i] == "--cost")
+            fp.setCost(options[++i]);
+        else if (options[i] == "--speculate")
+            fp.setSpeculate(stoul(options[++i]));
+        else if (options[i] == "--init")
+            constructive = (options[++i] == "constructive");
+        else if (options[i] == "--targeted-moves")
+            fp.setTargeted(true);
+        else if (options[i] == "--windowed-moves")
+            fp.setWindowed(true);
+        else if (options[i] == "--adaptive-moves")
+            fp.setAdaptive(true);
+    }
+    // the initial tree depends on the cost policy set above
+    if (constructive)
+        fp.constructInitTree();
+    fp.floorplan();
+    cout.rdbuf(coutBuf);
+
+    BenchRun run;
+    size_t pos = path.find_last_of('/');
+    run._name = (pos == string::npos)? path: path.substr(pos + 1);
+    run._seed = seed;
+    run._trials = fp.getTrialNum();
+    run._trace = fp.getTrace();
+#ifdef FP_ALLOC_TRACK
+    run._allocs = fp.getAllocPerMove();
+#else
+    run._allocs = -1;
+#endif
+    run._timeToFit = INF;
+    for (size_t i = 0, end = run._trace.size(); i < end; ++i) {
+        if (run._trace[i]._fit) {
+            run._timeToFit = run._trace[i]._time;
+            break;
+        }
+    }
+    // the trace is sampled once per temperature step, the cost at a budget
+    // is the one of the last sample within it
+    for (size_t b = 0, end = budgets.size(); b < end; ++b) {
+        double cost = INF;
+        for (size_t i = 0, n = run._trace.size(); i < n && run._trace[i]._time <= budgets[b]; ++i) {
+            if (run._trace[i]._fit)
+                cost = run._trace[i]._cost;
+        }
+        run._costs.push_back(cost);
+    }
+    return run;
+}
+
+void writeResults(const string& prefix, const vector<double>& budgets, const vector<BenchRun>& runs)
+{
+    fstream runFile((prefix + ".runs.csv").c_str(), ios::out);
+    fstream traceFile((prefix + ".trace.csv").c_str(), ios::out);
+    fstream jsonFile((prefix + ".json").c_str(), ios::out);
+    if (!runFile || !traceFile || !jsonFile) {
+        cerr << "Cannot write the results \"" << prefix
+             << ".*\". The program will be terminated..." << endl;
+        exit(1);
+    }
+
+    runFile << "case,seed,trials,time_to_fit";
+    for (size_t b = 0, end = budgets.size(); b < end; ++b)
+        runFile << ",cost@" << toCSV(budgets[b]);
+#ifdef FP_ALLOC_TRACK
+    runFile << ",allocs_per_move";
+#endif
+    runFile << '\n';
+    traceFile << "case,seed,time,cost,fit\n";
+    for (size_t i = 0, end = runs.size(); i < end; ++i) {
+        const BenchRun& run = runs[i];
+        runFile << run._name << ',' << run._seed << ',' << run._trials << ','
+                << toCSV(run._timeToFit);
+        for (size_t b = 0, n = run._costs.size(); b < n; ++b)
+            runFile << ',' << toCSV(run._costs[b]);
+#ifdef FP_ALLOC_TRACK
+        runFile << ',' << toCSV(run._allocs);
+#endif
+        runFile << '\n';
+        for (size_t j = 0, n = run._trace.size(); j < n; ++j) {
+            const TracePoint& point = run._trace[j];
+            traceFile << run._name << ',' << run._seed << ',' << toCSV(point._time) << ','
+                      << toCSV(point._fit? point._cost: INF) << ',' << point._fit << '\n';
+        }
+    }
+
+    // summary per testcase, in the order of the command line
+    vector<string> names;
+    for (size_t i = 0, end = runs.size(); i < end; ++i) {
+        if (find(names.begin(), names.end(), runs[i]._name) == names.end())
+            names.push_back(runs[i]._name);
+    }
+    jsonFile << "{\n  \"budgets\": [";
+    for (size_t b = 0, end = budgets.size(); b < end; ++b)
+        jsonFile << (b? ", ": "") << toJSON(budgets[b]);
+    jsonFile << "],\n  \"cases\": [";
+    for (size_t c = 0, end = names.size(); c < end; ++c) {
+        vector<double> timeToFit;
+        vector<vector<double> > costs(budgets.size());
+        for (size_t i = 0, n = runs.size(); i < n; ++i) {
+            if (runs[i]._name != names[c])
+                continue;
+            timeToFit.push_back(runs[i]._timeToFit);
+            for (size_t b = 0; b < budgets.size(); ++b)
+                costs[b].push_back(runs[i]._costs[b]);
+        }
+        size_t fitNum = timeToFit.size() - count(timeToFit.begin(), timeToFit.end(), INF);
+        jsonFile << (c? ",": "") << "\n    {\"case\": \"" << names[c] << "\", \"runs\": " << timeToFit.size()
+                 << ", \"fit_rate\": " << (double)fitNum / timeToFit.size()
+                 << ",\n     \"time_to_fit\": {\"median\": " << toJSON(percentile(timeToFit, 0.5))
+                 << ", \"p90\": " << toJSON(percentile(timeToFit, 0.9)) << "},\n     \"cost_at_budget\": [";
+        for (size_t b = 0; b < budgets.size(); ++b) {
+            jsonFile << (b? ", ": "") << "{\"median\": " << toJSON(percentile(costs[b], 0.5))
+                     << ", \"p90\": " << toJSON(percentile(costs[b], 0.9)) << "}";
+        }
+        jsonFile << "]}";
+    }
+    jsonFile << "\n  ]\n}\n";
+    return;
+}
+
+// Two-sided Mann-Whitney U test with the normal approximation and the
+// correction for ties. Returns the p-value, z > 0 if a tends to be larger.
+double mannWhitney(const vector<double>& a, const vector<double>& b, double& z)
+{
+    vector<pair<double, int> > all;
+    for (size_t i = 0; i < a.size(); ++i) all.push_back(make_pair(a[i], 0));
+    for (size_t i = 0; i < b.size(); ++i) all.push_back(make_pair(b[i], 1));
+    sort(all.begin(), all.end());
+    double n1 = a.size(), n2 = b.size(), n = n1 + n2;
+    double rankSum = 0, tieSum = 0;
+    for (size_t i = 0, end = all.size(); i < end; ) {
+        size_t j = i;
+        while (j < end && all[j].first == all[i].first)
+            ++j;
+        double rank = (i + 1 + j) / 2.0;
+        for (size_t k = i; k < j; ++k) {
+            if (all[k].second == 0)
+                rankSum += rank;
+        }
+        double t = j - i;
+        tieSum += t * t * t - t;
+        i = j;
+    }
+    double u = rankSum - n1 * (n1 + 1) / 2;
+    double mean = n1 * n2 / 2;
+    double var = n1 * n2 / 12 * ((n + 1) - tieSum / (n * (n - 1)));
+    if (n1 == 0 || n2 == 0 || var <= 0) {
+        z = 0;
+        return 1;
+    }
+    double diff = u - mean;
+    diff = (diff > 0)? max(0.0, diff - 0.5): min(0.0, diff + 0.5);
+    z = diff / sqrt(var);
+    return erfc(fabs(z) / sqrt(2.0));
+}
+
+// runs.csv -> case -> column -> values
+typedef map<string, map<string, vector<double> > > RunTable;
+
+bool readRuns(const string& fileName, RunTable& table, vector<string>& columns)
+{
+    fstream in(fileName.c_str(), ios::in);
+    string line;
+    if (!in || !getline(in, line))
+        return false;
+    vector<string> header = split(line, ',');
+    if (header.size() < 4 || header[0] != "case")
+        return false;
+    columns.assign(header.begin() + 3, header.end());
+    while (getline(in, line)) {
+        vector<string> fields = split(line, ',');
+        if (fields.size() != header.size())
+            return false;
+        for (size_t i = 3; i < fields.size(); ++i)
+            table[fields[0]][header[i]].push_back(fromCSV(fields[i]));
+    }
+    return true;
+}
+
+void compare(const string& fileA, const string& fileB)
+{
+    RunTable a, b;
+    vector<string> columns, columnsB;
+    if (!readRuns(fileA, a, columns) || !readRuns(fileB, b, columnsB)) {
+        cerr << "Cannot read the runs \"" << fileA << "\" and \"" << fileB
+             << "\". The program will be terminated..." << endl;
+        exit(1);
+    }
+    cout << "case,metric,median_a,median_b,z,p" << endl;
+    for (RunTable::iterator it = a.begin(); it != a.end(); ++it) {
+        if (b.find(it->first) == b.end())
+            continue;
+        for (size_t i = 0, end = columns.size(); i < end; ++i) {
+            const vector<double>& valuesA = it->second[columns[i]];
+            const vector<double>& valuesB = b[it->first][columns[i]];
+            if (valuesB.empty())
+                continue;
+            double z;
+            double p = mannWhitney(valuesA, valuesB, z);
+            cout << it->first << ',' << columns[i] << ','
+                 << toCSV(percentile(valuesA, 0.5)) << ',' << toCSV(percentile(valuesB, 0.5)) << ','
+                 << fixed << setprecision(3) << z << ',' << setprecision(4) << p
+                 << defaultfloat << endl;
+        }
+    }
+    return;
+}
+
+int main(int argc, char** argv)
+{
+    vector<string> cases, options;
+    vector<double> budgets;
+    string prefix = "bench";
+    size_t seedNum = 10;
+    double alpha = 0.5, allocLimit = -1;
+    bool verbose = false;
+
+    if (argc == 4 && string(argv[1]) == "--compare") {
+        compare(argv[2], argv[3]);
+        return 0;
+    }
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            cases.push_back(arg);
+        }
+        else if (arg == "--verbose") {
+            verbose = true;
+        }
+        else if (arg == "--targeted-moves" || arg == "--windowed-moves" ||
+                 arg == "--adaptive-moves") {
+            options.push_back(arg);
+        }
+        else if (i + 1 == argc) {
+            usage();
+        }
+        else if (arg == "--seeds") {
+            seedNum = stoul(argv[++i]);
+        }
+        else if (arg == "--budgets") {
+            vector<string> tokens = split(argv[++i], ',');
+            for (size_t j = 0; j < tokens.size(); ++j)
+                budgets.push_back(stod(tokens[j]));
+        }
+        else if (arg == "--alpha") {
+            alpha = stod(argv[++i]);
+        }
+        else if (arg == "--alloc-limit") {
+            allocLimit = stod(argv[++i]);
+        }
+        else if (arg == "--out") {
+            prefix = argv[++i];
+        }
+        else if (arg == "--engine" || arg == "--cost" || arg == "--speculate" ||
+                 arg == "--init") {
+            options.push_back(arg);
+            options.push_back(argv[++i]);
+        }
+        else {
+            usage();
+        }
+    }
+    if (cases.empty() || seedNum == 0)
+        usage();
+    if (budgets.empty()) {
+        budgets.push_back(1);
+        budgets.push_back(2);
+        budgets.push_back(5);
+        budgets.push_back(10);
+    }
+    sort(budgets.begin(), budgets.end());
+#ifndef FP_ALLOC_TRACK
+    if (allocLimit >= 0) {
+        cerr << "--alloc-limit needs a build with ALLOC_TRACK=1." << endl;
+        return 1;
+    }
+#endif
+    // refuse the combinations Floorplanner refuses, see main.cpp
+    size_t specThreads = 0;
+    bool adaptive = false;
+    for (size_t i = 0, end = options.size(); i < end; ++i) {
+        if (options[i] == "--speculate")
+            specThreads = stoul(options[++i]);
+        else if (options[i] == "--adaptive-moves")
+            adaptive = true;
+        else if (options[i] != "--targeted-moves" && options[i] != "--windowed-moves")
+            ++i;
+    }
+    if (specThreads > 0 && adaptive) {
+        cerr << "Speculative moves cannot adapt the odds of the move types." << endl;
+        return 1;
+    }
+#ifdef FP_ALLOC_TRACK
+    if (specThreads > 1) {
+        cerr << "The allocation tracking is not thread-safe, use --speculate 1." << endl;
+        return 1;
+    }
+#endif
+
+    vector<BenchRun> runs;
+    for (size_t c = 0, end = cases.size(); c < end; ++c) {
+        for (size_t seed = 1; seed <= seedNum; ++seed) {
+            runs.push_back(runCase(cases[c], seed, budgets, alpha, options, verbose));
+            const BenchRun& run = runs.back();
+            cerr << run._name << " seed " << seed << ": time to fit "
+                 << toCSV(run._timeToFit) << ", cost " << toCSV(run._costs.back());
+            if (run._allocs >= 0)
+                cerr << ", allocs/move " << run._allocs;
+            cerr << endl;
+        }
+    }
+    writeResults(prefix, budgets, runs);
+
+    // the annealing loop allocating too much fails the benchmark
+    bool overLimit = false;
+    for (size_t i = 0, end = runs.size(); allocLimit >= 0 && i < end; ++i) {
+        if (runs[i]._allocs > allocLimit) {
+            cerr << runs[i]._name << " seed " << runs[i]._seed << " allocates "
+                 << runs[i]._allocs << " times per move, the limit is " << allocLimit << endl;
+            overLimit = true;
+        }
+    }
+    return overLimit? 2: 0;
+}
@@ -0,0 +1,53 @@
+/****************************************************************************
+  FileName  [ costCache.cpp ]
+  Synopsis  [ Implementation of the cache of the floorplan costs. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.17 ]
+****************************************************************************/
+#include "costCache.h"
+using namespace std;
+
+void CostCache::resize(size_t size)
+{
+    size_t n = 1;
+    while (n < size)
+        n <<= 1;
+    _table.assign((size > 0)? n: 0, Entry());
+    this->clear();
+    return;
+}
+
+void CostCache::clear()
+{
+    for (size_t i = 0, end = _table.size(); i < end; ++i)
+        _table[i]._hash = 0;
+    _lookupNum = _hitNum = 0;
+    return;
+}
+
+bool CostCache::find(uint64_t hash, double& cost, size_t& maxX, size_t& maxY)
+{
+    if (_table.empty() || hash == 0)
+        return false;
+    ++_lookupNum;
+    const Entry& entry = _table[hash & (_table.size() - 1)];
+    if (entry._hash != hash)
+        return false;
+    ++_hitNum;
+    cost = entry._cost;
+    maxX = entry._maxX;
+    maxY = entry._maxY;
+    return true;
+}
+
+void CostCache::insert(uint64_t hash, double cost, size_t maxX, size_t maxY)
+{
+    if (_table.empty() || hash == 0)
+        return;
+    Entry& entry = _table[hash & (_table.size() - 1)];
+    entry._hash = hash;
+    entry._cost = cost;
+    entry._maxX = maxX;
+    entry._maxY = maxY;
+    return;
+}
@@ -0,0 +1,54 @@
+/****************************************************************************
+  FileName  [ costCache.h ]
+  Synopsis  [ Define a bounded cache of the costs of packed floorplans. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.17 ]
+****************************************************************************/
+#ifndef COSTCACHE_H
+#define COSTCACHE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+using namespace std;
+
+// Direct-mapped table from the hash of a floorplan to its cost and the size
+// of its packing, so that a candidate evaluated a moment ago is not packed
+// again. A newer entry replaces the one in its slot, and hash 0 is never
+// cached, it stands for a representation without a hash. The costs depend
+// on the normalization of the cost policy, so the cache is cleared whenever
+// it changes.
+class CostCache
+{
+public:
+    // constructor and destructor
+    CostCache(size_t size = 0) { resize(size); }
+    ~CostCache() { }
+
+    // basic access methods
+    size_t getSize() const      { return _table.size(); }
+    size_t getLookupNum() const { return _lookupNum; }
+    size_t getHitNum() const    { return _hitNum; }
+
+    // modify methods
+    // the size is rounded up to a power of two, 0 disables the cache
+    void resize(size_t size);
+    void clear();
+    bool find(uint64_t hash, double& cost, size_t& maxX, size_t& maxY);
+    void insert(uint64_t hash, double cost, size_t maxX, size_t maxY);
+
+private:
+    struct Entry
+    {
+        uint64_t    _hash;      // hash of the floorplan, 0 if empty
+        double      _cost;      // cost inside the program
+        size_t      _maxX;      // width of the packing
+        size_t      _maxY;      // height of the packing
+    };
+
+    vector<Entry>   _table;     // slots, indexed by the low bits of the hash
+    size_t          _lookupNum; // number of calls to find()
+    size_t          _hitNum;    // number of them found in the table
+};
+
+#endif  // COSTCACHE_H
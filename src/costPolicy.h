@@ -0,0 +1,97 @@
+/****************************************************************************
+  FileName  [ costPolicy.h ]
+  Synopsis  [ Define the cost functions used by the annealing. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.12 ]
+****************************************************************************/
+#ifndef COSTPOLICY_H
+#define COSTPOLICY_H
+
+#include <cstddef>
+#include <cmath>
+using namespace std;
+
+// Parameters of the cost of one annealing run. The averages and ranges are
+// estimated from random floorplans by Floorplanner::initSA().
+struct CostNorm
+{
+    double      _alpha;     // cost weight of bbox and area
+    size_t      _width;     // chip width limit
+    size_t      _height;    // chip height limit
+    double      _avgArea;   // average area
+    double      _avgWire;   // average wirelength
+    double      _lengthX;   // range of the chip width
+    double      _lengthY;   // range of the chip height
+};
+
+// A cost policy is a class with
+//     static const bool needsWire      whether eval() uses the wirelength
+//     static const bool outline        whether candidates violating the
+//                                      outline are skipped once a fit is seen
+//     static double eval(const CostNorm& norm, size_t maxX, size_t maxY, double wire)
+// The annealing is instantiated per policy, so the terms a policy does not
+// need (e.g. the HPWL for an area-only cost) are never computed.
+
+// area of the bounding box only
+struct AreaCost
+{
+    static const bool needsWire = false;
+    static const bool outline = false;
+    static double eval(const CostNorm& norm, size_t maxX, size_t maxY, double /*wire*/) {
+        return (double)maxX * maxY / norm._avgArea;
+    }
+};
+
+// wirelength only
+struct WireCost
+{
+    static const bool needsWire = true;
+    static const bool outline = false;
+    static double eval(const CostNorm& norm, size_t /*maxX*/, size_t /*maxY*/, double wire) {
+        return wire / norm._avgWire;
+    }
+};
+
+// alpha * area + (1 - alpha) * wirelength
+struct WeightedCost
+{
+    static const bool needsWire = true;
+    static const bool outline = false;
+    static double eval(const CostNorm& norm, size_t maxX, size_t maxY, double wire) {
+        double cost = norm._alpha * maxX * maxY / norm._avgArea;
+        cost += (1 - norm._alpha) * wire / norm._avgWire;
+        return cost;
+    }
+};
+
+// place for trying other objectives, by default the weighted cost plus the
+// difference between the aspect ratios of the chip and the outline
+struct CustomCost
+{
+    static const bool needsWire = true;
+    static const bool outline = false;
+    static double eval(const CostNorm& norm, size_t maxX, size_t maxY, double wire) {
+        double cost = WeightedCost::eval(norm, maxX, maxY, wire);
+        cost += abs((double(norm._width) / norm._height) - (double(maxX) / maxY));
+        return cost;
+    }
+};
+
+// penalty for exceeding the outline on top of another policy
+template <class Inner>
+struct FixedOutline
+{
+    static const bool needsWire = Inner::needsWire;
+    static const bool outline = true;
+    static double eval(const CostNorm& norm, size_t maxX, size_t maxY, double wire) {
+        double cost = 0;
+        // fit in width is harder than fit in height...
+        if (maxX > norm._width)
+            cost += 1.0e10 * (maxX - norm._width) / norm._lengthX;
+        if (maxY > norm._height)
+            cost += 1.0e8 * (maxY - norm._height) / norm._lengthY;
+        return cost + Inner::eval(norm, maxX, maxY, wire);
+    }
+};
+
+#endif  // COSTPOLICY_H
@@ -7,18 +7,31 @@
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <queue>
+#include <set>
+#include <algorithm>
 #include <cassert>
 #include <climits>
+#include <cfloat>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include "floorplanner.h"
+#include "serialize.h"
+#include "island.h"
 using namespace std;
 using namespace cv;
 
 double Floorplanner::getHPWL() const
 {
+    ALLOC_SCOPE("Floorplanner::getHPWL");
     double HPWL = 0;
     for (size_t i = 0, end = _netList.size(); i < end; ++i) {
         HPWL += _netList[i]->calcHPWL();
@@ -26,27 +39,40 @@ double Floorplanner::getHPWL() const
     return HPWL;
 }
 
-double Floorplanner::getCost(BStarTree& tree)
+template <class Cost>
+double Floorplanner::getCost(Representation& tree)
 {
-    double cost = 0;
     this->packTree(tree);
-    size_t maxX = Block::getMaxX();
-    size_t maxY = Block::getMaxY();
-
-    // fit in width is harder than fit in height...
-    if (maxX > _width)
-        cost += 1.0e10 * (maxX - _width) / _lengthX;
-    if (maxY > _height)
-        cost += 1.0e8 * (maxY - _height) / _lengthY;
-    // cost += 1.0e2 * ((maxX * maxY) - this->getModuleArea()) / _avgArea;
-    // if (this->checkFit())
-    // cost += 1.0e10 * abs((double(_width) / _height) - (double(maxX) / maxY));
-
-    cost += _alpha * maxX * maxY / _avgArea;
-    cost += (1 - _alpha) * this->getHPWL() / _avgWire;
+    double wire = Cost::needsWire? this->getHPWL(): 0;
+    return Cost::eval(_norm, Block::getMaxX(), Block::getMaxY(), wire);
+}
+
+template <class Cost, class Rep>
+double Floorplanner::getCachedCost(Rep& tree)
+{
+    uint64_t hash = tree.getHash();
+    double cost;
+    size_t maxX, maxY;
+    if (_costCache.find(hash, cost, maxX, maxY)) {
+        Block::setMaxX(maxX);
+        Block::setMaxY(maxY);
+        return cost;
+    }
+    cost = this->getCost<Cost>(tree);
+    _costCache.insert(hash, cost, Block::getMaxX(), Block::getMaxY());
     return cost;
 }
 
+double Floorplanner::getReportedCost() const
+{
+    return _alpha * this->getArea() + (1 - _alpha) * this->getHPWL();
+}
+
+double Floorplanner::getWallTime() const
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - _wallStart).count();
+}
+
 size_t Floorplanner::getModuleArea() const
 {
     size_t area = 0;
@@ -60,50 +86,213 @@ void Floorplanner::readCircuit(fstream& inBlk, fstream& inNet)
 {
     this->readBlock(inBlk);
     this->readNet(inNet);
+    this->calcBounds();
+    _hpwlBatch.reset(new HpwlBatch(_blockList, _netList));
 
     return;
 }
 
-void Floorplanner::floorplan()
+// Seed the annealing with the placement of a previous result file
+// <final cost> <wirelength> <area> <width> <height> <runtime>
+// { <macro name> <x1> <y1> <x2> <y2> }
+// A B*-tree is rebuilt from the placement. For the same circuit the placement
+// has to be one packed from a B*-tree, since a tree packing the blocks
+// elsewhere would start from a different floorplan than the one given, and
+// the result is never worse than it. After an engineering change, i.e. blocks
+// removed, added or resized, the rebuilt tree packs the blocks close to their
+// previous places, which is legal but may no longer fit, and is only the
+// starting point of the refinement.
+bool Floorplanner::readWarmStart(fstream& inRes)
 {
-    double bestCost = this->getCost(_bestTree);
-    bool fit = this->checkFit();
-    int trial = 0;
-    _start = clock();
-    while (!fit) {
-        ++trial;
-        cout << "Trial #" << trial << endl;
-        BStarTree tmpBestTree = this->floorplanSA();
-        double cost = this->getCost(tmpBestTree);
-        fit = this->checkFit();
-        if (bestCost > cost) {
-            _bestTree = tmpBestTree;
-            bestCost = cost;
+    string str;
+    for (size_t i = 0; i < 6; ++i) {
+        if (!(inRes >> str))
+            return false;
+    }
+
+    unordered_map<string, size_t> blockName2Id;
+    for (size_t i = 0, end = _blockList.size(); i < end; ++i) {
+        blockName2Id[_blockList[i]->getName()] = i;
+    }
+    vector<bool> placed(_blockList.size(), false);
+    string name;
+    size_t x1, y1, x2, y2, num = 0, removed = 0, resized = 0;
+    while (inRes >> name >> x1 >> y1 >> x2 >> y2) {
+        unordered_map<string, size_t>::iterator it = blockName2Id.find(name);
+        if (it == blockName2Id.end()) {
+            ++removed;
+            continue;
         }
+        if (x2 < x1 || y2 < y1 || placed[it->second])
+            continue;
+        Block* block = _blockList[it->second];
+        size_t w = x2 - x1, h = y2 - y1;
+        if ((w != block->getWidth() || h != block->getHeight()) &&
+            (w != block->getHeight() || h != block->getWidth()))
+            ++resized;
+        block->setPos(x1, y1, x2, y2);
+        placed[it->second] = true;
+        ++num;
     }
-    _stop = clock();
-    this->packTree(_bestTree);
-    this->drawFloorplan(_bestTree);
+    if (num == 0)
+        return false;
+    _warmExact = (removed == 0 && resized == 0 && num == _blockList.size());
 
+    // for the same circuit the rebuilt tree has to pack the blocks where they were
+    vector<size_t> pos;
+    for (size_t i = 0, end = _blockList.size(); i < end; ++i) {
+        pos.push_back(_blockList[i]->getX1());
+        pos.push_back(_blockList[i]->getY1());
+    }
+    unique_ptr<BStarTree> tree(new BStarTree(_blockList, placed));
+    this->packTree(*tree);
+    for (size_t i = 0, end = _blockList.size(); _warmExact && i < end; ++i) {
+        if (placed[i] && (_blockList[i]->getX1() != pos[2 * i] ||
+                          _blockList[i]->getY1() != pos[2 * i + 1])) {
+            cerr << "The warm start cannot be rebuilt as a B*-tree, the block \""
+                 << _blockList[i]->getName() << "\" would move." << endl;
+            return false;
+        }
+    }
+    cout << "Warm start from " << num << " of " << _blockList.size() << " blocks";
+    if (!_warmExact)
+        cout << " (" << _blockList.size() - num << " added, " << removed << " removed, "
+             << resized << " resized), repacked";
+    cout << endl;
 
-    return;
+    _initTree = move(tree);
+    _warmStart = true;
+    return true;
 }
 
-void Floorplanner::packTree(BStarTree& tree)
+// Seed the annealing with a constructive floorplan instead of the complete
+// binary tree in file order. The blocks are ordered by cluster growth: the
+// largest block first, then always the block most connected to the ordered
+// ones, where a net of k pins weighs 1 / (k - 1) and the larger block wins a
+// tie. Without the wirelength in the cost the order is by area only. The
+// ordered blocks fill rows up to the outline width, either lying or standing
+// where they fit, and turned to match the height of the first block of their
+// row. The packing overflowing the outline height less, then the smaller
+// one, is kept.
+void Floorplanner::constructInitTree()
 {
-    _contourList.clear();
-    _contourList.push_back(new LNode());
-    _contourList.back()->setPos(0, 0);
-    _contourList.push_back(new LNode());
-    _contourList.back()->setPos(INT_MAX, 0);
-    LNode* head = _contourList[0];
-    head->insertNext(_contourList[1]);
-    Block::setMaxX(0);
-    Block::setMaxY(0);
-    this->packBlock(tree._root, head);
-    for (size_t i = 0, end = _contourList.size(); i < end; ++i) {
-        delete _contourList[i];
+    size_t num = _blockList.size();
+    bool wire = (this->getCostPolicy() != "area");
+    vector<vector<size_t> > netBlocks(_netNum);
+    for (size_t i = 0; i < num; ++i) {
+        for (size_t j = 0, end = _blockNets[i].size(); j < end; ++j)
+            netBlocks[_blockNets[i][j]].push_back(i);
+    }
+
+    // a net adds its weight to its blocks once its first block is ordered
+    vector<size_t> order;
+    vector<double> gain(num, 0);
+    vector<bool> ordered(num, false), netUsed(_netNum, false);
+    priority_queue<pair<pair<double, size_t>, size_t> > queue;
+    for (size_t i = 0; i < num; ++i) {
+        queue.push(make_pair(make_pair(0.0, _blockList[i]->getArea()), i));
+    }
+    while (!queue.empty()) {
+        size_t id = queue.top().second;
+        double g = queue.top().first.first;
+        queue.pop();
+        // skip the entries outdated by a larger gain
+        if (ordered[id] || g != gain[id])
+            continue;
+        ordered[id] = true;
+        order.push_back(id);
+        for (size_t j = 0, end = _blockNets[id].size(); wire && j < end; ++j) {
+            size_t net = _blockNets[id][j];
+            size_t pinNum = _netList[net]->getTermList().size();
+            if (netUsed[net] || pinNum < 2)
+                continue;
+            netUsed[net] = true;
+            for (size_t k = 0, n = netBlocks[net].size(); k < n; ++k) {
+                size_t b = netBlocks[net][k];
+                if (ordered[b])
+                    continue;
+                gain[b] += 1.0 / (pinNum - 1);
+                queue.push(make_pair(make_pair(gain[b], _blockList[b]->getArea()), b));
+            }
+        }
+    }
+
+    vector<vector<size_t> > bestRows;
+    vector<bool> bestOrient;
+    size_t bestOver = 0, bestX = 0, bestY = 0;
+    for (size_t standing = 0; standing < 2; ++standing) {
+        vector<vector<size_t> > rows(1);
+        vector<bool> orient(num, false);
+        size_t x = 0, rowHeight = 0;
+        for (size_t k = 0; k < num; ++k) {
+            Block* block = _blockList[order[k]];
+            bool prefer = standing? (block->getWidth() > block->getHeight()):
+                                    (block->getWidth() < block->getHeight());
+            bool rotate = prefer;
+            while (true) {
+                size_t room = (x < _width)? _width - x: 0;
+                bool fit = block->getWidth(prefer) <= room;
+                bool fitRotated = block->getWidth(!prefer) <= room;
+                rotate = prefer;
+                if (!fit && fitRotated) {
+                    rotate = !prefer;
+                }
+                else if (x > 0 && fit && fitRotated) {
+                    // the height closest to the first block of the row, if not above
+                    size_t h = block->getHeight(prefer), hRotated = block->getHeight(!prefer);
+                    if ((hRotated <= rowHeight)? (h > rowHeight || hRotated > h):
+                                                 (h > rowHeight && hRotated < h))
+                        rotate = !prefer;
+                }
+                if (fit || fitRotated || x == 0)
+                    break;
+                rows.push_back(vector<size_t>());
+                x = 0;
+            }
+            if (x == 0)
+                rowHeight = block->getHeight(rotate);
+            orient[order[k]] = rotate;
+            rows.back().push_back(order[k]);
+            x += block->getWidth(rotate);
+        }
+        BStarTree tree(rows, orient);
+        this->packTree(tree);
+        size_t over = max(Block::getMaxY(), _height) - _height;
+        if (bestRows.empty() || over < bestOver || (over == bestOver && this->getArea() < bestX * bestY)) {
+            bestRows = rows;
+            bestOrient = orient;
+            bestOver = over;
+            bestX = Block::getMaxX();
+            bestY = Block::getMaxY();
+        }
     }
+    cout << "Constructive start of " << bestRows.size() << " rows, " << bestX << " x " << bestY
+         << " in the outline " << _width << " x " << _height << endl;
+
+    _initTree.reset(new BStarTree(bestRows, bestOrient));
+    _warmStart = true;
+    return;
+}
+
+void Floorplanner::floorplan()
+{
+    if (!this->checkFeasible())
+        exit(1);
+    // the islands share the result cache through their parent
+    if (_islandFd < 0 && this->loadCachedResult())
+        return;
+    if (_engine == "sp")
+        this->selectCost<SequencePair>();
+    else
+        this->selectCost<BStarTree>();
+    if (_islandFd < 0)
+        this->storeCachedResult();
+    return;
+}
+
+void Floorplanner::packTree(Representation& tree)
+{
+    tree.pack(_blockList);
     return;
 }
 
@@ -112,19 +301,43 @@ bool Floorplanner::checkFit()
     return ((Block::getMaxX() <= _width) && (Block::getMaxY() <= _height));
 }
 
-size_t Floorplanner::selectBestTree(vector<BStarTree>& trees, bool fit)
+// Reject the outlines which no floorplan fits in, otherwise the annealing
+// would be retried forever.
+bool Floorplanner::checkFeasible() const
 {
-    double bestCost = this->getCost(trees[0]);
-    size_t best = 0;
-    for (size_t i = 1, end = trees.size(); i < end; ++i) {
-        double cost = this->getCost(trees[i]);
-        if (fit && !this->checkFit()) continue;
-        if (cost < bestCost) {
-            cost = bestCost;
-            best = i;
+    if (this->getModuleArea() > _width * _height) {
+        cerr << "The blocks of area " << this->getModuleArea() << " cannot fit in the outline "
+             << _width << " x " << _height << ". The program will be terminated..." << endl;
+        return false;
+    }
+    for (size_t i = 0, end = _blockList.size(); i < end; ++i) {
+        size_t w = _blockList[i]->getWidth(), h = _blockList[i]->getHeight();
+        if ((w > _width || h > _height) && (h > _width || w > _height)) {
+            cerr << "The block \"" << _blockList[i]->getName() << "\" of " << w << " x " << h
+                 << " cannot fit in the outline " << _width << " x " << _height
+                 << ". The program will be terminated..." << endl;
+            return false;
         }
     }
-    return best;
+    return true;
+}
+
+// Whether the fitting floorplan tree is within the optimality gap, i.e. its
+// reported cost is at most (1 + _gap) times the lower bound.
+bool Floorplanner::checkGap(Representation& tree)
+{
+    this->packTree(tree);
+    return this->checkFit() && this->getReportedCost() <= (1 + _gap) * this->getCostBound();
+}
+
+template <class Cost, class Rep>
+size_t Floorplanner::selectBestTree(vector<Rep>& trees, bool fit)
+{
+    ALLOC_SCOPE("Floorplanner::selectBestTree");
+    _candCosts.resize(trees.size());
+    _candFits.resize(trees.size());
+    this->scoreTrees<Cost>(trees, _blockList, *_hpwlBatch, &_costCache, _candCosts, _candFits);
+    return this->selectBest<Cost>(_candCosts, _candFits, fit);
 }
 
 void Floorplanner::printSummary() const
@@ -133,12 +346,16 @@ void Floorplanner::printSummary() const
     double area = this->getArea();
     cout << endl;
     cout << "==================== Summary ====================" << endl;
-    cout << " Cost: "   << fixed << _alpha * area + (1 - _alpha) * wireLength << endl;
+    cout << " Cost: "   << fixed << this->getReportedCost() << endl;
     cout << " Wire: "   << fixed << wireLength << endl;
     cout << " Area: "   << fixed << area << endl;
     cout << " Width: "  << Block::getMaxX() << " (limit = " << _width << ")" << endl;
     cout << " Height: " << Block::getMaxY() << " (limit = " << _height << ")" << endl;
     cout << " Dead space: " << fixed << (area - this->getModuleArea()) << endl;
+    streamsize prec = cout.precision(2);
+    cout << " Lower bound: " << fixed << this->getCostBound() << " (gap = "
+         << (this->getReportedCost() / this->getCostBound() - 1) * 100 << "%)" << endl;
+    cout.precision(prec);
     cout << " Time: "   << (double)(_stop - _start) / CLOCKS_PER_SEC << " secs" << endl;
     cout << "=================================================" << endl;
     return;
@@ -192,7 +409,7 @@ void Floorplanner::writeResult(fstream& outFile)
     double area = this->getArea();
 
     // <final cost>
-    outFile << fixed << (_alpha * area + (1 - _alpha) * wireLength) << '\n';
+    outFile << fixed << this->getReportedCost() << '\n';
 
     // <total wirelength>
     outFile << fixed << wireLength << '\n';
@@ -223,157 +440,1242 @@ void Floorplanner::writeResult(fstream& outFile)
     return;
 }
 
-void Floorplanner::drawFloorplan(BStarTree& tree)
+// Longest side of the drawn image in pixels, larger floorplans are downscaled
+static const size_t DRAW_MAX_SIDE = 1024;
+
+// whether a value of the result file matches its recomputation, the values
+// are written with six decimals
+static bool checkValue(const string& what, double reported, double actual)
+{
+    if (fabs(reported - actual) <= 1e-6 * max(1.0, fabs(actual)))
+        return true;
+    cerr << "The reported " << what << " " << fixed << reported
+         << " differs from the recomputed " << actual << "." << endl;
+    return false;
+}
+
+// Check a result file written by writeResult(): every block is placed once
+// with its size in either orientation, no two blocks overlap, the floorplan
+// fits in the outline, and the reported cost, wirelength, area and size
+// match the placement. The positions are left in the blocks.
+bool Floorplanner::verifyResult(istream& inRes)
+{
+    double cost, wireLength, area, runtime;
+    size_t width, height;
+    if (!(inRes >> cost >> wireLength >> area >> width >> height >> runtime)) {
+        cerr << "Cannot read the header of the result." << endl;
+        return false;
+    }
+
+    unordered_map<string, size_t> blockName2Id;
+    for (size_t i = 0, end = _blockList.size(); i < end; ++i) {
+        blockName2Id[_blockList[i]->getName()] = i;
+    }
+    bool legal = true;
+    vector<bool> placed(_blockList.size(), false);
+    size_t maxX = 0, maxY = 0;
+    string name, last;
+    size_t x1, y1, x2, y2;
+    while (inRes >> name >> x1 >> y1 >> x2 >> y2) {
+        last = name;
+        unordered_map<string, size_t>::iterator it = blockName2Id.find(name);
+        if (it == blockName2Id.end() || placed[it->second]) {
+            cerr << "The block \"" << name << "\" is "
+                 << ((it == blockName2Id.end())? "unknown.": "placed twice.") << endl;
+            legal = false;
+            continue;
+        }
+        Block* block = _blockList[it->second];
+        placed[it->second] = true;
+        size_t w = (x2 > x1)? x2 - x1: 0, h = (y2 > y1)? y2 - y1: 0;
+        if (!(w == block->getWidth() && h == block->getHeight()) &&
+            !(w == block->getHeight() && h == block->getWidth())) {
+            cerr << "The block \"" << name << "\" of " << block->getWidth() << " x "
+                 << block->getHeight() << " is placed as " << w << " x " << h << "." << endl;
+            legal = false;
+            continue;
+        }
+        block->setPos(x1, y1, x2, y2);
+        maxX = max(maxX, x2);
+        maxY = max(maxY, y2);
+    }
+    if (!inRes.eof()) {
+        if (last.empty())
+            cerr << "Cannot read the first block of the result." << endl;
+        else
+            cerr << "Cannot read the result after the block \"" << last << "\"." << endl;
+        legal = false;
+    }
+    for (size_t i = 0, end = _blockList.size(); i < end; ++i) {
+        if (!placed[i]) {
+            cerr << "The block \"" << _blockList[i]->getName() << "\" is missing." << endl;
+            legal = false;
+        }
+    }
+    // the rest needs every block in place
+    if (!legal)
+        return false;
+
+    size_t a, b;
+    if (this->findOverlap(a, b)) {
+        cerr << "The blocks \"" << _blockList[a]->getName() << "\" and \""
+             << _blockList[b]->getName() << "\" overlap." << endl;
+        legal = false;
+    }
+    Block::setMaxX(maxX);
+    Block::setMaxY(maxY);
+    if (!this->checkFit()) {
+        cerr << "The floorplan of " << maxX << " x " << maxY << " exceeds the outline "
+             << _width << " x " << _height << "." << endl;
+        legal = false;
+    }
+    if (width != maxX || height != maxY) {
+        cerr << "The reported size " << width << " x " << height << " differs from the "
+             << "floorplan of " << maxX << " x " << maxY << "." << endl;
+        legal = false;
+    }
+    legal &= checkValue("cost", cost, this->getReportedCost());
+    legal &= checkValue("wirelength", wireLength, this->getHPWL());
+    legal &= checkValue("area", area, this->getArea());
+    return legal;
+}
+
+void Floorplanner::drawFloorplan(Representation& tree)
+{
+    if (_drawFormat == "none")
+        return;
+    this->packTree(tree);
+    cout << endl;
+    if (_drawFormat == "svg")
+        this->drawSvg("floorplan.svg");
+    else
+        this->drawRaster("floorplan.jpg");
+    return;
+}
+
+// Draw the packed blocks into an image of at most DRAW_MAX_SIDE pixels per
+// side, so the memory does not grow with the chip area.
+void Floorplanner::drawRaster(const string& fileName)
 {
     // opencv drawing
     // image(row, column, channel)
-    this->packTree(tree);
-    Mat image;
     size_t maxY = (Block::getMaxY() > _height)? Block::getMaxY(): _height;
     size_t maxX = (Block::getMaxX() > _width)? Block::getMaxX(): _width;
-    if (this->checkFit()) {
-        image = Mat(_height, _width, CV_8UC3);
-    }
-    else {
-        image = Mat(maxY, maxX, CV_8UC3);
-    }
-    size_t height = (_height > Block::getMaxY())? _height: Block::getMaxY();
+    double scale = min(1.0, (double)DRAW_MAX_SIDE / max(maxX, maxY));
+    int thick = (scale < 1)? 1: 3;
+    double fontScale = (scale < 1)? 0.4: 1;
+    Mat image(max(1, (int)(maxY * scale)), max(1, (int)(maxX * scale)), CV_8UC3);
     image.setTo(Scalar(255, 255, 255));
-    cout << endl;
     for (size_t i = 0, end = _blockList.size(); i < end; ++i) {
-        size_t x1 = _blockList[i]->getX1();
-        size_t y1 = height - _blockList[i]->getY1();
-        size_t x2 = _blockList[i]->getX2();
-        size_t y2 = height - _blockList[i]->getY2();
+        int x1 = _blockList[i]->getX1() * scale;
+        int y1 = (maxY - _blockList[i]->getY1()) * scale;
+        int x2 = _blockList[i]->getX2() * scale;
+        int y2 = (maxY - _blockList[i]->getY2()) * scale;
         rectangle(image, Point(x1, y1), Point(x2, y2), Scalar(0, 255, 255), -1, 8);
-        rectangle(image, Point(x1, y1), Point(x2, y2), Scalar(0, 128, 0), 3, 8);
-        putText(image, _blockList[i]->getName(), Point(x1 + 3, y1 - 5), FONT_HERSHEY_COMPLEX, 1, Scalar(0, 128, 0));
+        rectangle(image, Point(x1, y1), Point(x2, y2), Scalar(0, 128, 0), thick, 8);
+        putText(image, _blockList[i]->getName(), Point(x1 + 3, y1 - 5), FONT_HERSHEY_COMPLEX, fontScale, Scalar(0, 128, 0));
     }
     if (!this->checkFit()) {
-        rectangle(image, Point(0, maxY), Point(_width, maxY -_height), Scalar(0, 0, 255), 5, 8);
+        rectangle(image, Point(0, maxY * scale), Point(_width * scale, (maxY - _height) * scale),
+                  Scalar(0, 0, 255), thick + 2, 8);
     }
-    imwrite("floorplan.jpg", image);
+    imwrite(fileName, image);
 
     return;
 }
 
-BStarTree Floorplanner::floorplanSA()
+// Write the packed blocks as an SVG, one element per block. The coordinates
+// stay in chip units and the viewer scales them.
+void Floorplanner::drawSvg(const string& fileName)
 {
-    srand(time(NULL));
+    fstream out(fileName.c_str(), ios::out);
+    if (!out) {
+        cerr << "Cannot open the output file \"" << fileName << "\"" << endl;
+        return;
+    }
+    size_t maxY = (Block::getMaxY() > _height)? Block::getMaxY(): _height;
+    size_t maxX = (Block::getMaxX() > _width)? Block::getMaxX(): _width;
+    double scale = min(1.0, (double)DRAW_MAX_SIDE / max(maxX, maxY));
+    size_t fontSize = max((size_t)1, max(maxX, maxY) / 80);
+    // strokes of one and three pixels at the drawn size
+    double stroke = 1 / scale;
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << (size_t)(maxX * scale)
+        << "\" height=\"" << (size_t)(maxY * scale) << "\" viewBox=\"0 0 " << maxX << " " << maxY << "\">\n";
+    out << "<rect width=\"" << maxX << "\" height=\"" << maxY << "\" fill=\"white\"/>\n";
+    out << "<g fill=\"yellow\" stroke=\"green\" stroke-width=\"" << stroke << "\">\n";
+    for (size_t i = 0, end = _blockList.size(); i < end; ++i) {
+        Block* block = _blockList[i];
+        out << "<rect x=\"" << block->getX1() << "\" y=\"" << maxY - block->getY2()
+            << "\" width=\"" << block->getX2() - block->getX1()
+            << "\" height=\"" << block->getY2() - block->getY1() << "\"/>\n";
+    }
+    out << "</g>\n";
+    out << "<g fill=\"green\" font-family=\"sans-serif\" font-size=\"" << fontSize << "\">\n";
+    for (size_t i = 0, end = _blockList.size(); i < end; ++i) {
+        Block* block = _blockList[i];
+        string str = block->getName(), name;
+        // block names come from the input file, escape them for XML
+        for (size_t j = 0, jEnd = str.size(); j < jEnd; ++j) {
+            if (str[j] == '&')      name += "&amp;";
+            else if (str[j] == '<') name += "&lt;";
+            else if (str[j] == '>') name += "&gt;";
+            else                    name += str[j];
+        }
+        out << "<text x=\"" << block->getX1() + fontSize / 4 << "\" y=\"" << maxY - block->getY2() + fontSize
+            << "\">" << name << "</text>\n";
+    }
+    out << "</g>\n";
+    if (!this->checkFit()) {
+        out << "<rect x=\"0\" y=\"" << maxY - _height << "\" width=\"" << _width << "\" height=\""
+            << _height << "\" fill=\"none\" stroke=\"red\" stroke-width=\"" << 3 * stroke << "\"/>\n";
+    }
+    out << "</svg>\n";
 
-    // setup trees and costs
-    BStarTree prevTree = BStarTree(_blockList);
-    BStarTree tmpBestTree = BStarTree(_blockList);
-    double prevCost = this->getCost(prevTree);
-    double tmpBestCost = prevCost;
+    return;
+}
+
+// Checkpoint file layout (native byte order):
+// <magic> <version> <engine> <cost> <#blocks> <alpha> <elapsed secs> <rng state>
+// <normalization constants> <trial> <best cost> <best B*-tree>
+// <annealing state> <current B*-tree> <best B*-tree of this run>
+// <move selector>
+static const uint32_t CKPT_MAGIC = 0x4b435046;     // "FPCK"
+static const uint32_t CKPT_VERSION = 4;
+
+void Floorplanner::saveCheckpoint()
+{
+    // write to a temporary file first so that a preemption while writing
+    // never destroys the previous checkpoint
+    string tmpFile = _ckptFile + ".tmp";
+    fstream out(tmpFile.c_str(), ios::out | ios::binary | ios::trunc);
+    if (!out) {
+        cerr << "Cannot write the checkpoint \"" << tmpFile << "\"." << endl;
+        return;
+    }
+    writeBinary(out, CKPT_MAGIC);
+    writeBinary(out, CKPT_VERSION);
+    writeBinary<uint8_t>(out, _engine == "sp");
+    writeBinary<uint32_t>(out, _cost.size());
+    out.write(_cost.data(), _cost.size());
+    writeBinary<uint64_t>(out, _blockList.size());
+    writeBinary(out, _alpha);
+    writeBinary<double>(out, (double)(clock() - _start) / CLOCKS_PER_SEC);
+    writeBinary<uint64_t>(out, _rng.getState());
+
+    writeBinary(out, _norm._avgArea);
+    writeBinary(out, _norm._avgWire);
+    writeBinary(out, _maxLengthX);
+    writeBinary(out, _minLengthX);
+    writeBinary(out, _maxLengthY);
+    writeBinary(out, _minLengthY);
+    writeBinary(out, _norm._lengthX);
+    writeBinary(out, _norm._lengthY);
+
+    writeBinary<uint64_t>(out, _trial);
+    writeBinary(out, _bestCost);
+    _bestTree->write(out);
+
+    writeBinary(out, _sa._prevCost);
+    writeBinary(out, _sa._tmpBestCost);
+    writeBinary(out, _sa._T);
+    writeBinary<uint64_t>(out, _sa._count);
+    writeBinary<uint64_t>(out, _sa._step);
+    writeBinary<uint8_t>(out, _sa._fit);
+    _sa._prevTree->write(out);
+    _sa._tmpBestTree->write(out);
+    _selector.write(out);
+
+    out.close();
+    if (!out || rename(tmpFile.c_str(), _ckptFile.c_str()) != 0) {
+        cerr << "Cannot write the checkpoint \"" << _ckptFile << "\"." << endl;
+    }
+    return;
+}
+
+bool Floorplanner::loadCheckpoint(const string& fileName)
+{
+    fstream in(fileName.c_str(), ios::in | ios::binary);
+    uint32_t magic, version;
+    uint64_t blockNum, rngState, trial, count, step;
+    uint8_t engine, fit;
+    double alpha, elapsed;
+    if (!in || !readBinary(in, magic) || !readBinary(in, version))
+        return false;
+    if (magic != CKPT_MAGIC || version != CKPT_VERSION)
+        return false;
+    if (!readBinary(in, engine) || engine != (_engine == "sp"))
+        return false;
+    uint32_t costSize;
+    if (!readBinary(in, costSize) || costSize != _cost.size())
+        return false;
+    string cost(costSize, ' ');
+    if (!in.read(&cost[0], costSize) || cost != _cost)
+        return false;
+    if (!readBinary(in, blockNum) || blockNum != _blockList.size())
+        return false;
+    if (!readBinary(in, alpha) || alpha != _alpha)
+        return false;
+    if (!readBinary(in, elapsed) || !readBinary(in, rngState))
+        return false;
+
+    if (!readBinary(in, _norm._avgArea) || !readBinary(in, _norm._avgWire) ||
+        !readBinary(in, _maxLengthX) || !readBinary(in, _minLengthX) ||
+        !readBinary(in, _maxLengthY) || !readBinary(in, _minLengthY) ||
+        !readBinary(in, _norm._lengthX) || !readBinary(in, _norm._lengthY))
+        return false;
+
+    if (!readBinary(in, trial) || !readBinary(in, _bestCost) || !_bestTree->read(in, _blockList.size()))
+        return false;
+
+    if (!readBinary(in, _sa._prevCost) || !readBinary(in, _sa._tmpBestCost) ||
+        !readBinary(in, _sa._T) || !readBinary(in, count) ||
+        !readBinary(in, step) || !readBinary(in, fit))
+        return false;
+    if (!_sa._prevTree->read(in, _blockList.size()) || !_sa._tmpBestTree->read(in, _blockList.size()))
+        return false;
+    if (!_selector.read(in))
+        return false;
+
+    _rng.setState(rngState);
+    _trial = trial;
+    _sa._count = count;
+    _sa._step = step;
+    _sa._fit = fit;
+    _start -= elapsed * CLOCKS_PER_SEC;
+    return true;
+}
+
+// the cost policy, where "auto" is chosen by alpha
+string Floorplanner::getCostPolicy() const
+{
+    if (_cost == "auto")
+        return (_alpha == 1)? "area": (_alpha == 0)? "wire": "weighted";
+    return _cost;
+}
+
+// Pick the cost policy: "area", "wire", "weighted" or "custom", or "auto"
+// for the one matching alpha. The outline penalty is always added since the
+// floorplan has to fit into the outline.
+template <class Rep>
+void Floorplanner::selectCost()
+{
+    _cost = this->getCostPolicy();
+    if (_cost == "area")
+        this->runFloorplan<Rep, FixedOutline<AreaCost> >();
+    else if (_cost == "wire")
+        this->runFloorplan<Rep, FixedOutline<WireCost> >();
+    else if (_cost == "custom")
+        this->runFloorplan<Rep, FixedOutline<CustomCost> >();
+    else
+        this->runFloorplan<Rep, FixedOutline<WeightedCost> >();
+    return;
+}
+
+template <class Rep, class Cost>
+void Floorplanner::runFloorplan()
+{
+    bool fit = false;
+    bool resume = false;
+    _start = clock();
+    _wallStart = chrono::steady_clock::now();
+    _timeUp = false;
+    _gapReached = false;
+    _trace.clear();
+    _moveNum = _acceptNum = 0;
+    _lastSample = 0;
+    this->startPool();
+    _moveCtx._square = &_square;
+    _moveCtx._class = Cost::needsWire? &_netClass: &_shapeClass;
+    _norm._alpha = _alpha;
+    _norm._width = _width;
+    _norm._height = _height;
+    if (_warmStart && dynamic_cast<Rep*>(_initTree.get()) == NULL) {
+        cerr << "The warm start does not match the engine \"" << _engine
+             << "\". The program will be terminated..." << endl;
+        exit(1);
+    }
+    _bestTree.reset(_warmStart? new Rep(static_cast<Rep&>(*_initTree)): new Rep(_blockList));
+    _sa._prevTree.reset(new Rep());
+    _sa._tmpBestTree.reset(new Rep());
+    if (!_resumeFile.empty()) {
+        if (!this->loadCheckpoint(_resumeFile)) {
+            cerr << "Cannot resume from the checkpoint \"" << _resumeFile
+                 << "\". The program will be terminated..." << endl;
+            exit(1);
+        }
+        resume = true;
+    }
+    else {
+        _rng.setState(_seed);
+        _bestCost = this->getCost<Cost>(*_bestTree);
+        fit = this->checkFit();
+        _trial = 0;
+    }
+    // a warm start is refined even if it fits already, but only the previous
+    // result of the same circuit is kept if the refinement does no better
+    bool refine = _warmStart && !resume;
+    bool replace = !_warmExact && !resume;
+    while ((!fit || refine) && !_timeUp) {
+        refine = false;
+        if (resume) {
+            cout << "Resuming trial #" << _trial << endl;
+            resume = false;
+        }
+        else {
+            ++_trial;
+            cout << "Trial #" << _trial << endl;
+            this->initSA<Rep, Cost>();
+        }
+        Rep tmpBestTree = this->floorplanSA<Rep, Cost>();
+        if (_compact)
+            this->compact<Rep, Cost>(tmpBestTree);
+        // every trial normalizes the cost anew, the scores are comparable
+        if (replace || this->getScore(tmpBestTree) < this->getScore(*_bestTree))
+            static_cast<Rep&>(*_bestTree) = tmpBestTree;
+        replace = false;
+        _bestCost = this->getCost<Cost>(*_bestTree);
+        fit = this->checkFit();
+    }
+    _stop = clock();
+    if (_tracing)
+        this->addTracePoint(*_bestTree);
+    this->packTree(*_bestTree);
+    this->drawFloorplan(*_bestTree);
+
+
+    return;
+}
+
+// cooling rate of the annealing
+static const double COOLING_RATE = 0.90;
+// fewest temperature steps refining a warm start
+static const size_t WARM_STEPS = 20;
+
+template <class Rep, class Cost>
+void Floorplanner::initSA()
+{
+    // only the first trial starts from a warm start, a later one is due to a
+    // warm start which was not pulled into the outline
+    bool warm = _warmStart && _trial <= 1;
+
+    // setup trees
+    Rep initTree = warm? static_cast<Rep&>(*_initTree): Rep(_blockList);
+    Rep prevTree = initTree;
+    MoveContext ctx(&_rng);
+    ctx._square = _moveCtx._square;
+    ctx._class = _moveCtx._class;
 
     // setup parameters for annealing
     double accArea = 0, accWire = 0;
     _maxLengthX = _maxLengthY = 0;
     _minLengthX = _minLengthY = INT_MAX;
+    // a warm start is sampled by single moves around it rather than by a
+    // random walk, which would scramble it
     for (size_t i = 0; i < 1000; ++i) {
-        vector<BStarTree> trees = prevTree.perturb();
-        prevTree = trees[0];
-        this->packTree(prevTree);
+        vector<Rep> trees = prevTree.perturb(ctx);
+        this->packTree(trees[0]);
+        if (!warm)
+            prevTree = trees[0];
         accArea += this->getArea();
-        accWire += this->getHPWL();
+        if (Cost::needsWire)
+            accWire += this->getHPWL();
         _maxLengthX = (_maxLengthX > Block::getMaxX())? _maxLengthX: Block::getMaxX();
         _maxLengthY = (_maxLengthY > Block::getMaxY())? _maxLengthY: Block::getMaxY();
         _minLengthX = (_minLengthX < Block::getMaxX())? _minLengthX: Block::getMaxX();
         _minLengthY = (_minLengthY < Block::getMaxY())? _minLengthY: Block::getMaxY();
     }
-    _avgArea = accArea / 1000;
-    _avgWire = accWire / 1000;
-    _lengthX = _maxLengthX - _minLengthX;
-    _lengthY = _maxLengthY - _minLengthY;
+    _norm._avgArea = accArea / 1000;
+    _norm._avgWire = accWire / 1000;
+    _norm._lengthX = _maxLengthX - _minLengthX;
+    _norm._lengthY = _maxLengthY - _minLengthY;
+    _costCache.clear();
+
+    // setup costs
+    static_cast<Rep&>(*_sa._tmpBestTree) = initTree;
+    _sa._tmpBestCost = this->getCost<Cost>(initTree);
+    bool initFit = this->checkFit();
+    double prevCost = this->getCost<Cost>(prevTree);
 
     bool fit = this->checkFit();
     double accCost = 0, acc = 0;
-    double r = 0.90, p = 0.98;
-    size_t P = _blockList.size() * 100;
+    // a warm start is already good, so only a few uphill moves are accepted
+    double p = warm? 0.1: 0.98;
     for (size_t i = 0; i < 300; ++i) {
-        vector<BStarTree> trees = prevTree.perturb();
-        size_t best = this->selectBestTree(trees, fit);
+        vector<Rep> trees = prevTree.perturb(ctx);
+        size_t best = this->selectBestTree<Cost>(trees, fit);
         if (this->checkFit())
             fit = true;
-        double newCost = this->getCost(trees[best]);
+        double newCost = this->getCost<Cost>(trees[best]);
+        // leaving the outline is never accepted near a fitting warm start,
+        // its penalty would make the temperature as high as from scratch
+        if (warm && initFit && !this->checkFit())
+            continue;
         double delta = newCost - prevCost;
         if (delta > 0) {
             accCost += delta;
             acc += 1;
         }
-        prevTree = trees[best];
-        prevCost = newCost;
+        if (!warm) {
+            prevTree = trees[best];
+            prevCost = newCost;
+        }
     }
 
-    double T = abs((accCost/acc) / log(p));
-    size_t count = 0;
+    if (warm) {
+        static_cast<Rep&>(*_sa._prevTree) = initTree;
+        _sa._prevCost = _sa._tmpBestCost;
+        _sa._fit = initFit;
+    }
+    else {
+        static_cast<Rep&>(*_sa._prevTree) = prevTree;
+        _sa._prevCost = prevCost;
+        _sa._fit = fit;
+    }
+    _sa._T = (acc > 0)? abs((accCost/acc) / log(p)): 0;
+    // A warm start is refined for a few steps even if its uphill moves are
+    // smaller than the stop temperature. One not fitting in the outline, e.g.
+    // after blocks grew, is only pulled into it at that temperature, as the
+    // outline penalty would make the temperature as high as from scratch.
+    if (warm) {
+        double T = _stopTemp / pow(COOLING_RATE, WARM_STEPS);
+        _sa._T = initFit? max(_sa._T, T): T;
+    }
+    _sa._count = 0;
+    _sa._step = 0;
+    _selector.reset(Rep::MOVE_NUM);
+    return;
+}
+
+// smallest fraction of the blocks a windowed move may span
+static const double MIN_WINDOW = 0.1;
+
+template <class Rep, class Cost>
+Rep Floorplanner::floorplanSA()
+{
+    Rep& prevTree = static_cast<Rep&>(*_sa._prevTree);
+    Rep& tmpBestTree = static_cast<Rep&>(*_sa._tmpBestTree);
+    double r = COOLING_RATE;
+    size_t P = _blockList.size() * 100;
+    _lastCkpt = clock();
+    _moveCtx._rng = &_rng;
+    _moveCtx._selector = _adaptive? &_selector: NULL;
+    // a checkpoint written without adaptive moves has no selector state
+    if (_selector.getMoveNum() != Rep::MOVE_NUM)
+        _selector.reset(Rep::MOVE_NUM);
+    // the initial temperature of this run, also after a resume
+    double T0 = _sa._T / pow(r, _sa._count);
+    // the normalization may come from a checkpoint
+    _costCache.clear();
+    this->updateMoveContext(prevTree);
+    // moves evaluated ahead on the pool, dropped once one of them is accepted
+    vector<SpecMove<Rep> > specMoves;
+    size_t specNext = 0;
 
     // simulated annealing
-    while (T > 1.0) {
-        ++count;
+    while (_sa._T > _stopTemp && !_timeUp && !_gapReached) {
+#ifdef FP_ALLOC_TRACK
+        AllocStep allocStep = { _sa._T, _sa._step, getAllocStats() };
+#endif
+        // the moves span all blocks at T0 and MIN_WINDOW of them at _stopTemp
+        if (_windowed && T0 > _stopTemp)
+            _moveCtx._window = max(MIN_WINDOW, log(_sa._T / _stopTemp) / log(T0 / _stopTemp));
         // for each temperature, find P neighbors
-        for (size_t i = 0; i < P; ++i) {
-            vector<BStarTree> trees = prevTree.perturb();
-            size_t best = this->selectBestTree(trees, fit);
-            double newCost = this->getCost(trees[best]);
-            double delta = newCost - prevCost;
-            if (this->checkFit())
-                fit = true;
+        for (; _sa._step < P; ++_sa._step) {
+            if (_timeLimit > 0 && (_sa._step & 1023) == 0 && this->getWallTime() >= _timeLimit) {
+                _timeUp = true;
+                break;
+            }
+            if (!_ckptFile.empty() && (_sa._step & 1023) == 0 &&
+                clock() - _lastCkpt >= _ckptInterval * CLOCKS_PER_SEC) {
+                this->saveCheckpoint();
+                _lastCkpt = clock();
+            }
+            // a temperature step is 100 n moves, too long between samples
+            if (_telemetry && (_sa._step & 1023) == 0 && _telemetry->due(this->getWallTime()))
+                this->writeTelemetry();
+            vector<Rep> trees;
+            size_t best;
+            double newCost;
+            bool newFit;
+            Rng* rng = &_rng;
+            if (_pool) {
+                if (specNext >= specMoves.size()) {
+                    this->speculate<Rep, Cost>(prevTree, specMoves, min(_pool->getThreadNum(), P - _sa._step));
+                    specNext = 0;
+                }
+                SpecMove<Rep>& move = specMoves[specNext++];
+                // the seed of this move
+                _rng.next();
+                trees.swap(move._trees);
+                best = this->selectBest<Cost>(move._costs, move._fits, _sa._fit);
+                newCost = move._costs[best];
+                newFit = move._fits[best];
+                rng = &move._rng;
+            }
+            else {
+                trees = prevTree.perturb(_moveCtx);
+                best = this->selectBestTree<Cost>(trees, _sa._fit);
+                newCost = this->getCachedCost<Cost>(trees[best]);
+                newFit = this->checkFit();
+            }
+            ++_moveNum;
+            double delta = newCost - _sa._prevCost;
+            if (_adaptive && _sa._prevCost > 0)
+                _selector.reward(_moveCtx._move, max(0.0, -delta) / _sa._prevCost, trees.size());
+            if (newFit)
+                _sa._fit = true;
             // downhill move
             if (delta <= 0) {
+                specMoves.clear();
                 prevTree = trees[best];
-                prevCost = newCost;
-                if (prevCost < tmpBestCost) {
+                _sa._prevCost = newCost;
+                ++_acceptNum;
+                this->updateMoveContext(prevTree);
+                if (_sa._prevCost < _sa._tmpBestCost) {
                     tmpBestTree = prevTree;
-                    tmpBestCost = prevCost;
+                    _sa._tmpBestCost = _sa._prevCost;
                 }
             }
             // uphill move
-            else if (((double)rand() / RAND_MAX) < exp(-1 * delta / T)) {
+            else if (rng->uniform() < exp(-1 * delta / _sa._T)) {
+                specMoves.clear();
                 prevTree = trees[best];
-                prevCost = newCost;
+                _sa._prevCost = newCost;
+                ++_acceptNum;
+                this->updateMoveContext(prevTree);
             }
             else {
                 // do not accept this neighbor tree
             }
         }
-        cout << fixed << setprecision(2) << "T = " << T << ", cost = " << tmpBestCost << "       \r";
-        cout.flush();
-        T *= r;
+        specMoves.clear();
+#ifdef FP_ALLOC_TRACK
+        AllocStats allocEnd = getAllocStats();
+        allocStep._moves = _sa._step - allocStep._moves;
+        allocStep._stats._allocs = allocEnd._allocs - allocStep._stats._allocs;
+        allocStep._stats._bytes = allocEnd._bytes - allocStep._stats._bytes;
+        _allocSteps.push_back(allocStep);
+#endif
+        if (_tracing)
+            this->addTracePoint(tmpBestTree);
+        if (_gap > 0 && _sa._fit && this->checkGap(tmpBestTree))
+            _gapReached = true;
+        if (_telemetry && _telemetry->due(this->getWallTime()))
+            this->writeTelemetry();
+        // the telemetry replaces the progress line
+        if (!_telemetry) {
+            cout << fixed << setprecision(2) << "T = " << _sa._T << ", cost = " << _sa._tmpBestCost << "       \r";
+            cout.flush();
+        }
+        _sa._T *= r;
+        _sa._step = 0;
+        ++_sa._count;
+        if (_islandFd >= 0 && _sa._count % _migrateInterval == 0)
+            this->migrate<Rep, Cost>(prevTree, tmpBestTree);
     }
 
+    if (_telemetry)
+        this->writeTelemetry();
     this->drawFloorplan(tmpBestTree);
     return tmpBestTree;
 }
 
-void Floorplanner::packBlock(TNode* node, LNode* head)
+// Evaluate the next moveNum moves of the annealing chain from tree on the
+// pool. Move i is seeded with the i-th next number of _rng, which the chain
+// draws when it takes the move, so the chain is the same for any number of
+// threads.
+template <class Rep, class Cost>
+void Floorplanner::speculate(Rep& tree, vector<SpecMove<Rep> >& moves, size_t moveNum)
+{
+    Rng seeds = _rng;
+    moves.resize(moveNum);
+    for (size_t i = 0; i < moveNum; ++i) {
+        moves[i]._rng.setState(seeds.next());
+    }
+    _pool->run(moveNum, [&](size_t i, size_t thread) {
+        this->evalMove<Rep, Cost>(tree, moves[i], *_evalCtx[thread]);
+    });
+    return;
+}
+
+// getCost() of every candidate of the move, on the blocks of ctx
+template <class Rep, class Cost>
+void Floorplanner::evalMove(Rep& tree, SpecMove<Rep>& move, EvalContext& ctx)
+{
+    MoveContext moveCtx = _moveCtx;
+    moveCtx._rng = &move._rng;
+    move._trees = tree.perturb(moveCtx);
+    move._costs.resize(move._trees.size());
+    move._fits.resize(move._trees.size());
+    this->scoreTrees<Cost>(move._trees, ctx._blockList, ctx._hpwlBatch, NULL, move._costs, move._fits);
+    return;
+}
+
+// getCost() and checkFit() of every candidate, packed on blockList and
+// looked up in cache first if not NULL. The wirelengths of up to LANES
+// packings are evaluated together. Block::getMaxX() and getMaxY() are left
+// at the size of the last candidate, like after getCost() of each of them.
+template <class Cost, class Rep>
+void Floorplanner::scoreTrees(vector<Rep>& trees, vector<Block*>& blockList, HpwlBatch& batch,
+                              CostCache* cache, vector<double>& costs, vector<bool>& fits)
+{
+    const size_t LANES = HpwlBatch::LANES;
+    size_t maxX[LANES], maxY[LANES];
+    bool cached[LANES];
+    double wire[LANES];
+    for (size_t first = 0, num = trees.size(); first < num; first += LANES) {
+        size_t laneNum = min(LANES, num - first);
+        bool packed = false;
+        for (size_t k = 0; k < laneNum; ++k) {
+            Rep& tree = trees[first + k];
+            cached[k] = (cache != NULL && cache->find(tree.getHash(), costs[first + k], maxX[k], maxY[k]));
+            if (cached[k])
+                continue;
+            tree.pack(blockList);
+            maxX[k] = Block::getMaxX();
+            maxY[k] = Block::getMaxY();
+            if (Cost::needsWire)
+                batch.load(k, blockList);
+            packed = true;
+        }
+        if (Cost::needsWire && packed)
+            batch.eval(laneNum, wire);
+        for (size_t k = 0; k < laneNum; ++k) {
+            size_t i = first + k;
+            if (!cached[k]) {
+                costs[i] = Cost::eval(_norm, maxX[k], maxY[k], Cost::needsWire? wire[k]: 0);
+                if (cache != NULL)
+                    cache->insert(trees[i].getHash(), costs[i], maxX[k], maxY[k]);
+            }
+            fits[i] = (maxX[k] <= _width) && (maxY[k] <= _height);
+        }
+        Block::setMaxX(maxX[laneNum - 1]);
+        Block::setMaxY(maxY[laneNum - 1]);
+    }
+    return;
+}
+
+// the choice of selectBestTree() from the costs and fits of the candidates
+template <class Cost>
+size_t Floorplanner::selectBest(const vector<double>& costs, const vector<bool>& fits, bool fit) const
+{
+    double bestCost = costs[0];
+    size_t best = 0;
+    for (size_t i = 1, end = costs.size(); i < end; ++i) {
+        double cost = costs[i];
+        if (Cost::outline && fit && !fits[i]) continue;
+        if (cost < bestCost) {
+            bestCost = cost;
+            best = i;
+        }
+    }
+    return best;
+}
+
+// Collect the hints for the next perturbations from the packing of the
+// current floorplan tree.
+void Floorplanner::updateMoveContext(Representation& tree)
+{
+    _moveCtx._hot.clear();
+    if (!_targeted)
+        return;
+    this->packTree(tree);
+    if (this->checkFit())
+        return;
+    for (size_t i = 0, end = _blockList.size(); i < end; ++i) {
+        if (_blockList[i]->getX2() > _width || _blockList[i]->getY2() > _height)
+            _moveCtx._hot.push_back(i);
+    }
+    return;
+}
+
+// Island mode: islandNum worker processes anneal independently with the
+// seeds _seed, _seed + 1, ... and exchange their best floorplans through
+// this process every _migrateInterval temperature steps. The best result
+// of all islands becomes _bestTree, its runtime is the wall time. Only the
+// first island prints its progress and writes telemetry.
+void Floorplanner::floorplanIslands(size_t islandNum)
+{
+    if (!this->checkFeasible())
+        exit(1);
+    if (this->loadCachedResult())
+        return;
+    _start = clock();
+    _wallStart = chrono::steady_clock::now();
+    vector<int> fds;
+    vector<pid_t> pids;
+    cout.flush();
+    for (size_t i = 0; i < islandNum; ++i) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+            cerr << "Cannot create the socket of island " << i
+                 << ". The program will be terminated..." << endl;
+            exit(1);
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            cerr << "Cannot fork island " << i
+                 << ". The program will be terminated..." << endl;
+            exit(1);
+        }
+        if (pid == 0) {
+            for (size_t j = 0; j < fds.size(); ++j)
+                close(fds[j]);
+            close(sv[0]);
+            _islandFd = sv[1];
+            _seed += i;
+            // only the parent draws the best floorplan of all islands
+            _drawFormat = "none";
+            if (!_ckptFile.empty())
+                _ckptFile += "." + to_string(i);
+            if (i > 0) {
+                _telemetry.reset();
+                cout.rdbuf(NULL);
+            }
+            this->floorplan();
+            double score;
+            sendMessage(_islandFd, this->islandMessage(ISLAND_FINAL, *_bestTree, score));
+            cout.flush();
+            _exit(0);
+        }
+        close(sv[1]);
+        fds.push_back(sv[0]);
+        pids.push_back(pid);
+    }
+
+    // serve the exchanges until every island is done
+    string best;
+    double bestScore = DBL_MAX;
+    size_t running = islandNum;
+    vector<pollfd> polls(islandNum);
+    for (size_t i = 0; i < islandNum; ++i) {
+        polls[i].fd = fds[i];
+        polls[i].events = POLLIN;
+    }
+    while (running > 0) {
+        if (poll(&polls[0], polls.size(), -1) < 0)
+            continue;
+        for (size_t i = 0; i < islandNum; ++i) {
+            if (polls[i].fd < 0 || polls[i].revents == 0)
+                continue;
+            string data;
+            double score;
+            if (!recvMessage(polls[i].fd, data) || data.size() < 1 + sizeof(score)) {
+                // the island died, its last exchange is kept
+                close(polls[i].fd);
+                polls[i].fd = -1;
+                --running;
+                continue;
+            }
+            memcpy(&score, &data[1], sizeof(score));
+            if (score < bestScore) {
+                best = data;
+                bestScore = score;
+            }
+            if (data[0] == ISLAND_FINAL || !sendMessage(polls[i].fd, best)) {
+                close(polls[i].fd);
+                polls[i].fd = -1;
+                --running;
+            }
+        }
+    }
+    for (size_t i = 0; i < islandNum; ++i)
+        waitpid(pids[i], NULL, 0);
+
+    _bestTree.reset(this->createRep());
+    istringstream is(best.size() > 1 + sizeof(double)? best.substr(1 + sizeof(double)): "");
+    if (!_bestTree->read(is, _blockList.size())) {
+        cerr << "No island returned a floorplan. The program will be terminated..." << endl;
+        exit(1);
+    }
+    _stop = _start + this->getWallTime() * CLOCKS_PER_SEC;
+    this->packTree(*_bestTree);
+    this->drawFloorplan(*_bestTree);
+    this->storeCachedResult();
+    return;
+}
+
+void Floorplanner::setResultCache(const string& dir)
+{
+    _resultCache.reset(new ResultCache(dir, ResultCache::hashText(this->getCircuitText())));
+    return;
+}
+
+// Everything read from the input files, in their order, since the trees refer
+// to the blocks by their index.
+string Floorplanner::getCircuitText() const
+{
+    ostringstream os;
+    os << "outline " << _width << " " << _height << "\n";
+    for (size_t i = 0, end = _blockList.size(); i < end; ++i) {
+        os << "block " << _blockList[i]->getName() << " " << _blockList[i]->getWidth()
+           << " " << _blockList[i]->getHeight() << "\n";
+    }
+    for (size_t i = 0, end = _termList.size(); i < end; ++i) {
+        os << "terminal " << _termList[i]->getName() << " " << _termList[i]->getX1()
+           << " " << _termList[i]->getY1() << "\n";
+    }
+    for (size_t i = 0, end = _netList.size(); i < end; ++i) {
+        const vector<Terminal*> termList = _netList[i]->getTermList();
+        os << "net";
+        for (size_t j = 0, jEnd = termList.size(); j < jEnd; ++j)
+            os << " " << termList[j]->getName();
+        os << "\n";
+    }
+    return os.str();
+}
+
+// Look the circuit up in the result cache. The floorplan of the same engine,
+// cost policy and alpha is the result, without annealing. Otherwise the one
+// of the same engine with the closest alpha is a warm start, unless the run
+// starts from a floorplan already. A resumed run goes on with its checkpoint.
+bool Floorplanner::loadCachedResult()
+{
+    vector<CachedResult> results;
+    if (!_resultCache || !_resumeFile.empty() || !_resultCache->read(results))
+        return false;
+    string cost = this->getCostPolicy();
+    size_t near = results.size();
+    for (size_t i = 0, end = results.size(); i < end; ++i) {
+        const CachedResult& result = results[i];
+        if (result._engine != _engine)
+            continue;
+        if (result._cost == cost && result._alpha == _alpha) {
+            unique_ptr<Representation> tree(this->createRep());
+            istringstream is(result._tree);
+            if (!tree->read(is, _blockList.size())) {
+                cerr << "The cached floorplan does not match the circuit, it is annealed again." << endl;
+                _cacheRejected = true;
+                continue;
+            }
+            cout << "Result cache hit of cost " << fixed << result._score << endl;
+            _bestTree = move(tree);
+            _trial = 0;
+            _start = _stop = clock();
+            _wallStart = chrono::steady_clock::now();
+            this->packTree(*_bestTree);
+            this->drawFloorplan(*_bestTree);
+            return true;
+        }
+        if (near == end || fabs(result._alpha - _alpha) < fabs(results[near]._alpha - _alpha))
+            near = i;
+    }
+    if (near < results.size() && !_warmStart) {
+        unique_ptr<Representation> tree(this->createRep());
+        istringstream is(results[near]._tree);
+        if (tree->read(is, _blockList.size())) {
+            cout << "Warm start from the result cache of alpha " << results[near]._alpha << endl;
+            _initTree = move(tree);
+            _warmStart = true;
+        }
+    }
+    return false;
+}
+
+// Offer the best floorplan to the result cache, if it fits in the outline
+void Floorplanner::storeCachedResult()
+{
+    if (!_resultCache)
+        return;
+    this->packTree(*_bestTree);
+    if (!this->checkFit())
+        return;
+    CachedResult result;
+    result._engine = _engine;
+    result._cost = this->getCostPolicy();
+    result._alpha = _alpha;
+    result._score = this->getReportedCost();
+    ostringstream os;
+    _bestTree->write(os);
+    result._tree = os.str();
+    if (!_resultCache->store(result, _cacheRejected))
+        cerr << "Cannot write the result cache \"" << _resultCache->getDir() << "\"." << endl;
+    return;
+}
+
+// Sweep a vertical line over the blocks from left to right. The blocks cut
+// by the line are kept ordered by y, and as long as no two of them overlap
+// their y ranges are disjoint, so an entering block only has to be checked
+// against its two neighbors. At the same x the blocks ending there leave
+// before the others enter, as touching blocks do not overlap.
+bool Floorplanner::findOverlap(size_t& a, size_t& b) const
+{
+    // <x> <whether the block enters> <block>
+    vector<pair<pair<size_t, bool>, size_t> > events;
+    events.reserve(2 * _blockList.size());
+    for (size_t i = 0, end = _blockList.size(); i < end; ++i) {
+        Block* block = _blockList[i];
+        if (block->getX1() == block->getX2() || block->getY1() == block->getY2())
+            continue;
+        events.push_back(make_pair(make_pair(block->getX1(), true), i));
+        events.push_back(make_pair(make_pair(block->getX2(), false), i));
+    }
+    sort(events.begin(), events.end());
+
+    // <y1> <block> of the blocks cut by the line
+    set<pair<size_t, size_t> > active;
+    for (size_t i = 0, end = events.size(); i < end; ++i) {
+        size_t id = events[i].second;
+        Block* block = _blockList[id];
+        pair<size_t, size_t> key(block->getY1(), id);
+        if (!events[i].first.second) {
+            active.erase(key);
+            continue;
+        }
+        set<pair<size_t, size_t> >::iterator next = active.lower_bound(key);
+        if (next != active.end() && _blockList[next->second]->getY1() < block->getY2()) {
+            a = next->second;
+            b = id;
+            return true;
+        }
+        if (next != active.begin()) {
+            set<pair<size_t, size_t> >::iterator prev = next;
+            --prev;
+            if (_blockList[prev->second]->getY2() > block->getY1()) {
+                a = prev->second;
+                b = id;
+                return true;
+            }
+        }
+        active.insert(next, key);
+    }
+    return false;
+}
+
+Representation* Floorplanner::createRep() const
+{
+    if (_engine == "sp")
+        return new SequencePair();
+    return new BStarTree();
+}
+
+// The reported cost of a fitting floorplan, or above any reported cost by how
+// much the outline is exceeded. Unlike the cost inside the program, which is
+// normalized per run, the score compares floorplans of different runs. The
+// tree is left packed.
+double Floorplanner::getScore(Representation& tree)
+{
+    this->packTree(tree);
+    if (this->checkFit())
+        return this->getReportedCost();
+    return 1e100 * max(Block::getMaxX(), _width) / _width
+                 * max(Block::getMaxY(), _height) / _height;
+}
+
+// <type> <score> <tree>, see island.h and getScore().
+string Floorplanner::islandMessage(uint8_t type, Representation& tree, double& score)
+{
+    score = this->getScore(tree);
+    ostringstream os;
+    writeBinary(os, type);
+    writeBinary(os, score);
+    tree.write(os);
+    return os.str();
+}
+
+// Greedy compaction: try every local move of the tree in turn and keep the
+// ones lowering the cost, until none does. Rejected moves are undone in
+// place and the blocks get back their saved positions, so every try costs
+// one packing. The wirelength is updated over the nets of the blocks the
+// packing moved only.
+template <class Rep, class Cost>
+void Floorplanner::compact(Rep& tree)
 {
-    Block* block = _blockList[node->getId()];
-    size_t x = head->_x;
-    size_t prevY = head->_y, maxY = head->_y;
-    size_t width = block->getWidth(node->getOrient());
-    size_t height = block->getHeight(node->getOrient());
-    while (x + width > head->_next->_x) {
-        prevY = head->_next->_y;
-        maxY = (maxY > prevY)? maxY: prevY;
-        head->deleteNext();
+    struct Pos { size_t _x1, _y1, _x2, _y2; };
+    size_t blockNum = _blockList.size();
+
+    this->packTree(tree);
+    vector<Pos> pos(blockNum);
+    for (size_t i = 0; i < blockNum; ++i) {
+        Block* block = _blockList[i];
+        Pos p = { block->getX1(), block->getY1(), block->getX2(), block->getY2() };
+        pos[i] = p;
     }
-    block->setPos(x, maxY, x + width, maxY + height);
-    if (x + width > Block::getMaxX())
-        Block::setMaxX(x + width);
-    if (maxY + height > Block::getMaxY())
-        Block::setMaxY(maxY + height);
-    head->_y = maxY + height;
-    if (x + width < head->_next->_x) {
-        _contourList.push_back(new LNode());
-        _contourList.back()->setPos(x + width, prevY);
-        head->insertNext(_contourList.back());
+    vector<double> netWire(_netList.size(), 0);
+    double wire = 0;
+    if (Cost::needsWire) {
+        for (size_t i = 0, end = _netList.size(); i < end; ++i)
+            wire += (netWire[i] = _netList[i]->calcHPWL());
     }
-    if (node->_left != NULL)
-        packBlock(node->_left, head->_next);
-    if (node->_right != NULL)
-        packBlock(node->_right, head);
+    size_t maxX = Block::getMaxX(), maxY = Block::getMaxY();
+    double cost = Cost::eval(_norm, maxX, maxY, wire);
+    double initCost = cost;
+    size_t accepted = 0;
+
+    vector<size_t> moved, nets;
+    vector<bool> netMark(_netList.size(), false);
+    vector<double> newNetWire;
+    bool improved = true;
+    while (improved) {
+        improved = false;
+        for (size_t k = 0, end = tree.getLocalMoveNum(); k < end; ++k) {
+            size_t undo = tree.applyLocalMove(k);
+            if (undo == NO_LOCAL_MOVE)
+                continue;
+            this->packTree(tree);
+            moved.clear();
+            nets.clear();
+            for (size_t i = 0; i < blockNum; ++i) {
+                Block* block = _blockList[i];
+                if (block->getX1() != pos[i]._x1 || block->getY1() != pos[i]._y1 ||
+                    block->getX2() != pos[i]._x2 || block->getY2() != pos[i]._y2)
+                    moved.push_back(i);
+            }
+            double newWire = wire;
+            newNetWire.clear();
+            if (Cost::needsWire) {
+                for (size_t i = 0; i < moved.size(); ++i) {
+                    for (size_t j = 0; j < _blockNets[moved[i]].size(); ++j) {
+                        size_t net = _blockNets[moved[i]][j];
+                        if (!netMark[net]) {
+                            netMark[net] = true;
+                            nets.push_back(net);
+                        }
+                    }
+                }
+                for (size_t i = 0; i < nets.size(); ++i) {
+                    netMark[nets[i]] = false;
+                    newNetWire.push_back(_netList[nets[i]]->calcHPWL());
+                    newWire += newNetWire.back() - netWire[nets[i]];
+                }
+            }
+            double newCost = Cost::eval(_norm, Block::getMaxX(), Block::getMaxY(), newWire);
+            // a relative margin keeps rounding errors from cycling
+            if (newCost < cost - 1e-12 * fabs(cost)) {
+                for (size_t i = 0; i < moved.size(); ++i) {
+                    Block* block = _blockList[moved[i]];
+                    Pos p = { block->getX1(), block->getY1(), block->getX2(), block->getY2() };
+                    pos[moved[i]] = p;
+                }
+                for (size_t i = 0; i < nets.size(); ++i)
+                    netWire[nets[i]] = newNetWire[i];
+                wire = newWire;
+                cost = newCost;
+                maxX = Block::getMaxX();
+                maxY = Block::getMaxY();
+                improved = true;
+                ++accepted;
+            }
+            else {
+                tree.undoLocalMove(k, undo);
+                for (size_t i = 0; i < moved.size(); ++i) {
+                    const Pos& p = pos[moved[i]];
+                    _blockList[moved[i]]->setPos(p._x1, p._y1, p._x2, p._y2);
+                }
+                Block::setMaxX(maxX);
+                Block::setMaxY(maxY);
+            }
+        }
+    }
+    cout << "Compaction: cost " << initCost << " -> " << cost << " by "
+         << accepted << " moves" << endl;
+    return;
+}
+
+// Send the best floorplan of this run to the parent and continue from the
+// best one of all islands if it is better.
+template <class Rep, class Cost>
+void Floorplanner::migrate(Rep& prevTree, Rep& tmpBestTree)
+{
+    double score, bestScore;
+    string data;
+    if (!sendMessage(_islandFd, this->islandMessage(ISLAND_EXCHANGE, tmpBestTree, score)) ||
+        !recvMessage(_islandFd, data)) {
+        // the parent is gone, go on alone
+        close(_islandFd);
+        _islandFd = -1;
+        return;
+    }
+    istringstream is(data);
+    uint8_t type;
+    Rep tree;
+    if (!readBinary(is, type) || !readBinary(is, bestScore) || bestScore >= score ||
+        !tree.read(is, _blockList.size()))
+        return;
+    double cost = this->getCost<Cost>(tree);
+    if (this->checkFit())
+        _sa._fit = true;
+    prevTree = tree;
+    tmpBestTree = tree;
+    _sa._prevCost = _sa._tmpBestCost = cost;
+    this->updateMoveContext(prevTree);
+    return;
+}
+
+bool Floorplanner::setTelemetry(const string& fileName, double interval)
+{
+    _telemetry.reset(new Telemetry());
+    if (!_telemetry->open(fileName, interval)) {
+        _telemetry.reset();
+        return false;
+    }
+    return true;
+}
+
+// Write a progress sample of the current annealing run, the rates are
+// over the moves since the previous sample.
+void Floorplanner::writeTelemetry()
+{
+    TelemetrySample sample;
+    sample._time = this->getWallTime();
+    sample._trial = _trial;
+    sample._T = _sa._T;
+    sample._bestCost = _sa._tmpBestCost;
+    sample._curCost = _sa._prevCost;
+    sample._acceptRate = _moveNum? (double)_acceptNum / _moveNum: 0;
+    sample._moveRate = (sample._time > _lastSample)? _moveNum / (sample._time - _lastSample): 0;
+    sample._fit = _sa._fit;
+    _telemetry->write(sample);
+    _moveNum = _acceptNum = 0;
+    _lastSample = sample._time;
+    return;
+}
+
+#ifdef FP_ALLOC_TRACK
+// allocations per move over all moves of floorplanSA()
+double Floorplanner::getAllocPerMove() const
+{
+    size_t moves = 0, allocs = 0;
+    for (size_t i = 0, end = _allocSteps.size(); i < end; ++i) {
+        moves += _allocSteps[i]._moves;
+        allocs += _allocSteps[i]._stats._allocs;
+    }
+    return moves? (double)allocs / moves: 0;
+}
+
+void Floorplanner::reportAlloc(ostream& os) const
+{
+    os << "Allocations per move by temperature step:" << endl;
+    size_t moves = 0, allocs = 0, bytes = 0;
+    for (size_t i = 0, end = _allocSteps.size(); i < end; ++i) {
+        const AllocStep& step = _allocSteps[i];
+        moves += step._moves;
+        allocs += step._stats._allocs;
+        bytes += step._stats._bytes;
+        if (step._moves == 0)
+            continue;
+        os << "  T = " << scientific << setprecision(3) << step._T << fixed
+           << "  moves " << setw(6) << step._moves
+           << "  allocs/move " << setw(8) << setprecision(2) << (double)step._stats._allocs / step._moves
+           << "  bytes/move " << setw(10) << (double)step._stats._bytes / step._moves << endl;
+    }
+    os << "Allocations per move: " << fixed << setprecision(2)
+       << (moves? (double)allocs / moves: 0) << " allocs, "
+       << (moves? (double)bytes / moves: 0) << " bytes over " << moves << " moves" << endl;
+    AllocScope::report(os);
+    return;
+}
+#endif
+
+// Record the best reported cost seen so far, taking tree into account.
+void Floorplanner::addTracePoint(Representation& tree)
+{
+    double best = _trace.empty()? DBL_MAX: _trace.back()._cost;
+    this->packTree(tree);
+    if (this->checkFit() && this->getReportedCost() < best)
+        best = this->getReportedCost();
+    TracePoint point = { this->getWallTime(), best, best < DBL_MAX };
+    _trace.push_back(point);
     return;
 }
 
@@ -416,6 +1718,19 @@ void Floorplanner::readBlock(fstream& inBlk)
         _termName2Ptr[name] = _blockList.back();
     }
 
+    // blocks of the same size are alike for the area, whatever their names
+    map<pair<size_t, size_t>, size_t> shapes;
+    for (size_t i = 0; i < _blockNum; ++i) {
+        Block* block = _blockList[i];
+        pair<size_t, size_t> shape(block->getWidth(), block->getHeight());
+        if (shapes.find(shape) == shapes.end()) {
+            size_t id = shapes.size();
+            shapes[shape] = id;
+        }
+        _shapeClass.push_back(shapes[shape]);
+        _square.push_back(shape.first == shape.second);
+    }
+
     // read terminals
     // <terminal name> terminal <x coordinate> <y coordinate>
     for (size_t i = 0; i < _termNum; ++i) {
@@ -460,5 +1775,106 @@ void Floorplanner::readNet(fstream& inNet)
         }
     }
 
+    unordered_map<Terminal*, size_t> blockId;
+    for (size_t i = 0; i < _blockNum; ++i)
+        blockId[_blockList[i]] = i;
+    _blockNets.resize(_blockNum);
+    for (size_t i = 0; i < _netNum; ++i) {
+        vector<Terminal*> termList = _netList[i]->getTermList();
+        for (size_t j = 0, n = termList.size(); j < n; ++j) {
+            unordered_map<Terminal*, size_t>::iterator it = blockId.find(termList[j]);
+            if (it != blockId.end())
+                _blockNets[it->second].push_back(i);
+        }
+    }
+
+    // for the wirelength, alike blocks have to be on the same nets as well
+    map<pair<size_t, vector<size_t> >, size_t> classes;
+    for (size_t i = 0; i < _blockNum; ++i) {
+        pair<size_t, vector<size_t> > key(_shapeClass[i], _blockNets[i]);
+        if (classes.find(key) == classes.end()) {
+            size_t id = classes.size();
+            classes[key] = id;
+        }
+        _netClass.push_back(classes[key]);
+    }
+
+    return;
+}
+
+// Lower bounds over the floorplans fitting in the outline. The area is at
+// least the total area of the blocks. The pin of a block is its center, which
+// lies at least half of the shorter side of the block inside the outline, so
+// the bounding box of a net covers its terminals and reaches the range of the
+// center of each of its blocks. The coordinates are doubled as in calcHPWL().
+void Floorplanner::calcBounds()
+{
+    unordered_map<Terminal*, Block*> blockOf;
+    for (size_t i = 0, end = _blockList.size(); i < end; ++i) {
+        blockOf[_blockList[i]] = _blockList[i];
+    }
+    _areaBound = this->getModuleArea();
+    _wireBound = 0;
+    for (size_t i = 0, end = _netList.size(); i < end; ++i) {
+        const vector<Terminal*> termList = _netList[i]->getTermList();
+        // the bounding box spans at least [lowX, highX] x [lowY, highY]
+        double highX = 0, highY = 0, lowX = 2.0 * _width, lowY = 2.0 * _height;
+        for (size_t j = 0, jEnd = termList.size(); j < jEnd; ++j) {
+            unordered_map<Terminal*, Block*>::iterator it = blockOf.find(termList[j]);
+            if (it == blockOf.end()) {
+                double x = termList[j]->getX1() + termList[j]->getX2();
+                double y = termList[j]->getY1() + termList[j]->getY2();
+                highX = max(highX, x);  lowX = min(lowX, x);
+                highY = max(highY, y);  lowY = min(lowY, y);
+            }
+            else {
+                Block* block = it->second;
+                double side = min(block->getWidth(), block->getHeight());
+                highX = max(highX, side);   lowX = min(lowX, 2.0 * _width - side);
+                highY = max(highY, side);   lowY = min(lowY, 2.0 * _height - side);
+            }
+        }
+        _wireBound += (max(0.0, highX - lowX) + max(0.0, highY - lowY)) / 2.0;
+    }
+    return;
+}
+
+// The threads are started by the process which anneals, threads do not
+// survive the fork() of an island.
+void Floorplanner::startPool()
+{
+    if (_specThreadNum == 0 || _pool)
+        return;
+    _pool.reset(new WorkerPool(_specThreadNum));
+    _evalCtx.clear();
+    for (size_t i = 0; i < _specThreadNum; ++i) {
+        _evalCtx.push_back(unique_ptr<EvalContext>(new EvalContext(_blockList, _netList)));
+    }
     return;
 }
+
+EvalContext::EvalContext(const vector<Block*>& blockList, const vector<Net*>& netList) :
+    _hpwlBatch(blockList, netList)
+{
+    unordered_map<Terminal*, Block*> copyOf;
+    for (size_t i = 0, end = blockList.size(); i < end; ++i) {
+        _blockList.push_back(new Block(*blockList[i]));
+        copyOf[blockList[i]] = _blockList.back();
+    }
+    for (size_t i = 0, end = netList.size(); i < end; ++i) {
+        const vector<Terminal*> termList = netList[i]->getTermList();
+        _netList.push_back(new Net());
+        for (size_t j = 0, jEnd = termList.size(); j < jEnd; ++j) {
+            unordered_map<Terminal*, Block*>::iterator it = copyOf.find(termList[j]);
+            _netList.back()->addTerm((it == copyOf.end())? termList[j]: it->second);
+        }
+    }
+}
+
+EvalContext::~EvalContext()
+{
+    for (size_t i = 0, end = _blockList.size(); i < end; ++i)
+        delete _blockList[i];
+    for (size_t i = 0, end = _netList.size(); i < end; ++i)
+        delete _netList[i];
+}
@@ -4,53 +4,107 @@
   Author    [ Fu-Yu Chuang ]
   Date      [ 2017.4.27 ]
 ****************************************************************************/
+#ifndef FLOORPLANNER_H
+#define FLOORPLANNER_H
+
 #include <string>
 #include <vector>
 #include <fstream>
 #include <climits>
 #include <map>
+#include <unordered_map>
+#include <ctime>
+#include <memory>
+#include <chrono>
 #include "module.h"
+#include "representation.h"
 #include "bStarTree.h"
+#include "sequencePair.h"
+#include "costPolicy.h"
+#include "moveSelector.h"
+#include "costCache.h"
+#include "workerPool.h"
+#include "hpwlBatch.h"
+#include "resultCache.h"
+#include "telemetry.h"
+#include "allocTrack.h"
+#include "rng.h"
 using namespace std;
 
-// Linked list node
-class LNode
+// State of one annealing run, kept outside floorplanSA() so that it can be
+// written to a checkpoint and the run can be resumed from it. The floorplans
+// are owned here and have the type of the engine being annealed.
+struct SAState
 {
-    friend class Floorplanner;
+    unique_ptr<Representation>  _prevTree;      // current floorplan
+    unique_ptr<Representation>  _tmpBestTree;   // best floorplan of this run
+    double      _prevCost;      // cost of the current floorplan
+    double      _tmpBestCost;   // cost of the best floorplan of this run
+    double      _T;             // current temperature
+    size_t      _count;         // number of temperature steps done
+    size_t      _step;          // number of neighbors visited at this temperature
+    bool        _fit;           // whether a fitting floorplan has been seen
+};
 
-private:
-    // constructor and destructor
-    LNode(LNode* next = NULL) :
-        _next(next) { }
-    ~LNode()    { }
+// Best reported cost of the fitting floorplans seen until a wall time,
+// DBL_MAX if none fits yet.
+struct TracePoint
+{
+    double      _time;          // wall time since the start of floorplan()
+    double      _cost;          // best reported cost so far
+    bool        _fit;           // whether a fitting floorplan has been seen
+};
 
-    void setPos(size_t x, size_t y) {
-        _x = x; _y = y;
-    }
+// Copies of the blocks and nets, on which a thread of the speculative moves
+// packs its candidates. The nets refer to the copied blocks and to the
+// shared terminals, which are never written.
+struct EvalContext
+{
+    EvalContext(const vector<Block*>& blockList, const vector<Net*>& netList);
+    ~EvalContext();
 
-    void insertNext(LNode* node) {
-        LNode* n = _next;
-        _next = node;
-        node->_next = n;
-    }
+    vector<Block*>  _blockList;     // copies of the blocks
+    vector<Net*>    _netList;       // copies of the nets
+    HpwlBatch       _hpwlBatch;     // wirelength of the copied blocks
+};
 
-    void deleteNext() {
-        _next = _next->_next;
-    }
+// A move evaluated ahead of the annealing chain. It draws its random numbers
+// from its own generator, seeded by the main one, so that it does not depend
+// on the moves before it.
+template <class Rep>
+struct SpecMove
+{
+    Rng             _rng;           // generator of the move, after perturbing
+    vector<Rep>     _trees;         // candidates
+    vector<double>  _costs;         // cost of each candidate
+    vector<bool>    _fits;          // whether each candidate fits in the outline
+};
 
-    LNode*      _next;      // next linked list node
-    size_t      _x;         // coordinate x
-    size_t      _y;         // coordinate y
+#ifdef FP_ALLOC_TRACK
+// Allocations made by the moves of one temperature step.
+struct AllocStep
+{
+    double      _T;             // temperature
+    size_t      _moves;         // number of moves
+    AllocStats  _stats;         // allocations of the moves
 };
+#endif
 
 class Floorplanner
 {
 public:
     // constructor and destructor
     Floorplanner(fstream& inBlk, fstream& inNet) :
-        _start(0), _stop(0) {
+        _start(0), _stop(0), _engine("bstar"), _cost("auto"), _warmStart(false),
+        _warmExact(false), _targeted(false), _windowed(false), _adaptive(false), _trial(0),
+        _seed(time(NULL)),
+        _ckptInterval(60), _lastCkpt(0), _timeLimit(0), _timeUp(false), _tracing(false),
+        _moveNum(0), _acceptNum(0), _lastSample(0), _islandFd(-1), _migrateInterval(10),
+        _compact(false), _stopTemp(1), _gap(0), _gapReached(false), _drawFormat("jpg"),
+        _costCache(1 << 16), _specThreadNum(0), _cacheRejected(false) {
         readCircuit(inBlk, inNet);
-        _bestTree = BStarTree(_blockList);
+        _norm._avgArea = _norm._avgWire = 1;
+        _norm._lengthX = _norm._lengthY = 1;
         _maxLengthX = 0;
         _maxLengthY = 0;
         _minLengthX = INT_MAX;
@@ -66,21 +120,62 @@ public:
     size_t getTermNum() const   { return _termNum; }
     size_t getNetNum() const    { return _width; }
 
+    size_t getTrialNum() const  { return _trial; }
+    const vector<TracePoint>& getTrace() const { return _trace; }
+
     size_t getArea() const      { return Block::getMaxX() * Block::getMaxY(); }
     double getHPWL() const;
+    // the cost written to the result file
+    double getReportedCost() const;
+    double getWallTime() const;
     // getting the cost inside the program, rather than the cost reported
-    double getCost(BStarTree& tree);
+    template <class Cost>
+    double getCost(Representation& tree);
+    // getCost() through the cost cache, which sets the size of the packing
+    // but not the positions of the blocks on a hit
+    template <class Cost, class Rep>
+    double getCachedCost(Rep& tree);
     size_t getModuleArea() const;
+    // lower bounds over the floorplans fitting in the outline
+    double getAreaBound() const { return _areaBound; }
+    double getWireBound() const { return _wireBound; }
+    double getCostBound() const { return _alpha * _areaBound + (1 - _alpha) * _wireBound; }
 
     // set functions
     void setAlpha(double alpha) { _alpha = alpha; }
+    void setSeed(uint64_t seed) { _seed = seed; }
+    void setEngine(const string& engine) { _engine = engine; }
+    void setCost(const string& cost)    { _cost = cost; }
+    void setTargeted(bool targeted)     { _targeted = targeted; }
+    void setWindowed(bool windowed)     { _windowed = windowed; }
+    void setAdaptive(bool adaptive)     { _adaptive = adaptive; }
+    void setCheckpoint(const string& fileName, double interval) {
+        _ckptFile = fileName; _ckptInterval = interval;
+    }
+    void setResume(const string& fileName) { _resumeFile = fileName; }
+    void setTimeLimit(double secs)      { _timeLimit = secs; }
+    void setTracing(bool tracing)       { _tracing = tracing; }
+    bool setTelemetry(const string& fileName, double interval);
+    void setMigrateInterval(size_t steps)   { _migrateInterval = steps; }
+    void setCompact(bool compact)       { _compact = compact; }
+    void setStopTemp(double T)          { _stopTemp = T; }
+    void setGap(double gap)             { _gap = gap; }
+    void setDrawFormat(const string& format)    { _drawFormat = format; }
+    void setCostCache(size_t entries)   { _costCache.resize(entries); }
+    void setSpeculate(size_t threadNum) { _specThreadNum = threadNum; }
+    void setResultCache(const string& dir);
 
     // modify methods
     void readCircuit(fstream& inBlk, fstream& inNet);
+    bool readWarmStart(fstream& inRes);
+    void constructInitTree();
     void floorplan();
-    void packTree(BStarTree& tree);
+    void floorplanIslands(size_t islandNum);
+    void packTree(Representation& tree);
     bool checkFit();
-    size_t selectBestTree(vector<BStarTree>& trees, bool fit);
+    bool checkFeasible() const;
+    template <class Cost, class Rep>
+    size_t selectBestTree(vector<Rep>& trees, bool fit);
 
     // member functions about reporting
     void printSummary() const;
@@ -88,7 +183,17 @@ public:
     void reportTerm()   const;
     void reportNet()    const;
     void writeResult(fstream& outFile);
-    void drawFloorplan(BStarTree& tree);
+    // check a result file against the circuit, printing every violation
+    bool verifyResult(istream& inRes);
+    void drawFloorplan(Representation& tree);
+#ifdef FP_ALLOC_TRACK
+    double getAllocPerMove() const;
+    void reportAlloc(ostream& os) const;
+#endif
+
+    // checkpointing long annealing runs
+    void saveCheckpoint();
+    bool loadCheckpoint(const string& fileName);
 
 private:
     double              _alpha;         // cost weight of bbox and area
@@ -99,30 +204,110 @@ private:
     size_t              _netNum;        // number of nets
     clock_t             _start;         // starting time
     clock_t             _stop;          // stopping time
-    BStarTree           _bestTree;      // best B*-tree
-    vector<LNode*>      _contourList;   // list of contour
+    string              _engine;        // representation, "bstar" or "sp"
+    string              _cost;          // cost policy, see selectCost()
+    unique_ptr<Representation>  _bestTree;  // best floorplan
+    unique_ptr<Representation>  _initTree;  // starting floorplan of a warm start
+    bool                _warmStart;     // whether to start from _initTree
+    bool                _warmExact;     // whether _initTree packs a previous result of the same circuit
+    bool                _targeted;      // whether to target blocks outside the outline
+    bool                _windowed;      // whether to shrink the range of the moves with T
+    bool                _adaptive;      // whether to adapt the odds of the move types
+    MoveContext         _moveCtx;       // hints for perturbing the current floorplan
+    MoveSelector        _selector;      // odds of the move types, if adaptive
+    double              _bestCost;      // cost of the best floorplan
+    size_t              _trial;         // number of annealing runs started
+    SAState             _sa;            // state of the current annealing run
+    uint64_t            _seed;          // seed of the random number generator
+    Rng                 _rng;           // random number generator
+    string              _ckptFile;      // checkpoint file, empty if disabled
+    double              _ckptInterval;  // seconds between two checkpoints
+    clock_t             _lastCkpt;      // time of the last checkpoint
+    string              _resumeFile;    // checkpoint to resume from
+    chrono::steady_clock::time_point _wallStart;    // wall time of the start
+    double              _timeLimit;     // wall seconds to stop after, 0 if unlimited
+    bool                _timeUp;        // whether _timeLimit has been reached
+    bool                _tracing;       // whether to record _trace
+    vector<TracePoint>  _trace;         // best-so-far cost over wall time
+    unique_ptr<Telemetry>   _telemetry; // progress samples, NULL if disabled
+    size_t              _moveNum;       // moves since the last sample
+    size_t              _acceptNum;     // accepted moves since the last sample
+    double              _lastSample;    // wall time of the last sample
+    int                 _islandFd;      // socket to the parent in an island, -1 otherwise
+    size_t              _migrateInterval;   // temperature steps between two exchanges
+    bool                _compact;       // whether to compact the result of every run
+    double              _stopTemp;      // temperature ending the annealing
+    double              _gap;           // optimality gap ending the annealing, 0 if disabled
+    bool                _gapReached;    // whether a floorplan within _gap has been found
+    string              _drawFormat;    // format of the drawn floorplan, "jpg", "svg" or "none"
+    CostCache           _costCache;     // costs of the recently packed candidates
+    unique_ptr<HpwlBatch>   _hpwlBatch; // wirelength of the candidates of a move
+    vector<double>      _candCosts;     // costs of the candidates of a move
+    vector<bool>        _candFits;      // whether each candidate fits in the outline
+    size_t              _specThreadNum; // threads of the speculative moves, 0 if disabled
+    unique_ptr<WorkerPool>  _pool;      // the threads, started by runFloorplan()
+    vector<unique_ptr<EvalContext> > _evalCtx;  // blocks and nets of each thread
+    unique_ptr<ResultCache> _resultCache;   // best floorplans across runs, NULL if disabled
+    bool                _cacheRejected; // whether the cached floorplan was unreadable
+    double              _areaBound;     // lower bound of the area
+    double              _wireBound;     // lower bound of the wirelength
+    vector<vector<size_t> > _blockNets; // nets of each block
+    vector<bool>        _square;        // whether each block is square
+    vector<size_t>      _shapeClass;    // blocks of the same size share a class
+    vector<size_t>      _netClass;      // blocks of the same size and nets share a class
+#ifdef FP_ALLOC_TRACK
+    vector<AllocStep>   _allocSteps;    // allocations of every temperature step
+#endif
     vector<Block*>      _blockList;     // list of blocks
     vector<Terminal*>   _termList;      // list of terminals
     vector<Net*>        _netList;       // list of nets
 
-    map<string, Terminal*>  _termName2Ptr;  // mapping from terminal name to its pointer
+    unordered_map<string, Terminal*> _termName2Ptr;   // mapping from terminal name to its pointer
 
     // data members for computing cost
-    double              _avgArea;
-    double              _avgWire;
+    CostNorm            _norm;
     double              _maxLengthX;
     double              _minLengthX;
     double              _maxLengthY;
     double              _minLengthY;
-    double              _lengthX;
-    double              _lengthY;
 
     // private member functions
-    BStarTree floorplanSA();
-    void packBlock(TNode* node, LNode* head);
+    string getCostPolicy() const;
+    template <class Rep> void selectCost();
+    template <class Rep, class Cost> void runFloorplan();
+    template <class Rep, class Cost> void initSA();
+    template <class Rep, class Cost> Rep floorplanSA();
+    template <class Rep, class Cost>
+    void speculate(Rep& tree, vector<SpecMove<Rep> >& moves, size_t moveNum);
+    template <class Rep, class Cost>
+    void evalMove(Rep& tree, SpecMove<Rep>& move, EvalContext& ctx);
+    template <class Cost, class Rep>
+    void scoreTrees(vector<Rep>& trees, vector<Block*>& blockList, HpwlBatch& batch,
+                    CostCache* cache, vector<double>& costs, vector<bool>& fits);
+    template <class Cost>
+    size_t selectBest(const vector<double>& costs, const vector<bool>& fits, bool fit) const;
+    void updateMoveContext(Representation& tree);
+    void addTracePoint(Representation& tree);
+    void writeTelemetry();
+    Representation* createRep() const;
+    double getScore(Representation& tree);
+    string islandMessage(uint8_t type, Representation& tree, double& score);
+    template <class Rep, class Cost> void migrate(Rep& prevTree, Rep& tmpBestTree);
+    template <class Rep, class Cost> void compact(Rep& tree);
 
     void readBlock(fstream& inBlk);
     void readNet(fstream& inNet);
+    void calcBounds();
+    void startPool();
+    void drawRaster(const string& fileName);
+    void drawSvg(const string& fileName);
+    bool checkGap(Representation& tree);
+    string getCircuitText() const;
+    bool findOverlap(size_t& a, size_t& b) const;
+    bool loadCachedResult();
+    void storeCachedResult();
 
 };
 
+#endif  // FLOORPLANNER_H
+
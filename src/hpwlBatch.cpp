@@ -0,0 +1,94 @@
+/****************************************************************************
+  FileName  [ hpwlBatch.cpp ]
+  Synopsis  [ Implementation of the batched wirelength evaluation. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.19 ]
+****************************************************************************/
+#include <unordered_map>
+#include <climits>
+#include <algorithm>
+#include "hpwlBatch.h"
+using namespace std;
+
+HpwlBatch::HpwlBatch(const vector<Block*>& blockList, const vector<Net*>& netList)
+{
+    unordered_map<Terminal*, uint32_t> blockId;
+    for (size_t i = 0, end = blockList.size(); i < end; ++i) {
+        blockId[blockList[i]] = i;
+    }
+    _netStart.push_back(0);
+    for (size_t i = 0, end = netList.size(); i < end; ++i) {
+        const vector<Terminal*> termList = netList[i]->getTermList();
+        // the same initial box as Net::calcHPWL()
+        uint32_t minX = INT_MAX, maxX = 0, minY = INT_MAX, maxY = 0;
+        for (size_t j = 0, jEnd = termList.size(); j < jEnd; ++j) {
+            unordered_map<Terminal*, uint32_t>::iterator it = blockId.find(termList[j]);
+            if (it != blockId.end()) {
+                _pins.push_back(it->second);
+                continue;
+            }
+            uint32_t x = termList[j]->getX1() + termList[j]->getX2();
+            uint32_t y = termList[j]->getY1() + termList[j]->getY2();
+            minX = min(minX, x);    maxX = max(maxX, x);
+            minY = min(minY, y);    maxY = max(maxY, y);
+        }
+        _netStart.push_back(_pins.size());
+        _fixed.push_back(minX);
+        _fixed.push_back(maxX);
+        _fixed.push_back(minY);
+        _fixed.push_back(maxY);
+    }
+    _x.assign(blockList.size() * LANES, 0);
+    _y.assign(blockList.size() * LANES, 0);
+}
+
+void HpwlBatch::load(size_t lane, const vector<Block*>& blockList)
+{
+    for (size_t i = 0, end = blockList.size(); i < end; ++i) {
+        _x[i * LANES + lane] = blockList[i]->getX1() + blockList[i]->getX2();
+        _y[i * LANES + lane] = blockList[i]->getY1() + blockList[i]->getY2();
+    }
+    return;
+}
+
+void HpwlBatch::eval(size_t laneNum, double* wire) const
+{
+    // the loops over the lanes have a fixed length, the lanes beyond
+    // laneNum are computed and dropped
+    if (laneNum <= 1)
+        this->evalLanes<1>(laneNum, wire);
+    else if (laneNum <= 4)
+        this->evalLanes<4>(laneNum, wire);
+    else
+        this->evalLanes<LANES>(laneNum, wire);
+    return;
+}
+
+template <size_t N>
+void HpwlBatch::evalLanes(size_t laneNum, double* wire) const
+{
+    uint32_t minX[N], maxX[N], minY[N], maxY[N];
+    for (size_t k = 0; k < laneNum; ++k)
+        wire[k] = 0;
+    for (size_t i = 0, end = _netStart.size() - 1; i < end; ++i) {
+        for (size_t k = 0; k < N; ++k) {
+            minX[k] = _fixed[4 * i];
+            maxX[k] = _fixed[4 * i + 1];
+            minY[k] = _fixed[4 * i + 2];
+            maxY[k] = _fixed[4 * i + 3];
+        }
+        for (size_t j = _netStart[i], jEnd = _netStart[i + 1]; j < jEnd; ++j) {
+            const uint32_t* x = &_x[_pins[j] * LANES];
+            const uint32_t* y = &_y[_pins[j] * LANES];
+            for (size_t k = 0; k < N; ++k) {
+                minX[k] = (x[k] < minX[k])? x[k]: minX[k];
+                maxX[k] = (x[k] > maxX[k])? x[k]: maxX[k];
+                minY[k] = (y[k] < minY[k])? y[k]: minY[k];
+                maxY[k] = (y[k] > maxY[k])? y[k]: maxY[k];
+            }
+        }
+        for (size_t k = 0; k < laneNum; ++k)
+            wire[k] += ((maxX[k] - minX[k]) + (maxY[k] - minY[k])) / 2.0;
+    }
+    return;
+}
@@ -0,0 +1,50 @@
+/****************************************************************************
+  FileName  [ hpwlBatch.h ]
+  Synopsis  [ Define the wirelength evaluation of several packings at once. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.19 ]
+****************************************************************************/
+#ifndef HPWLBATCH_H
+#define HPWLBATCH_H
+
+#include <vector>
+#include <cstdint>
+#include "module.h"
+using namespace std;
+
+// HPWL of up to LANES packings of the same blocks, e.g. the candidates of
+// one move. The pins of every net are kept as block indices in one array,
+// with the bounding box of its terminals, which never move, computed once.
+// The doubled centers of the blocks are stored lane by lane, so that one
+// pass over the nets updates the boxes of all packings together and the
+// compiler can vectorize the inner loops over the lanes. The doubled
+// coordinates are 32-bit, i.e. the packings stay below 2^31 in both
+// directions. The result is the same as summing Net::calcHPWL() over the
+// nets.
+class HpwlBatch
+{
+public:
+    static const size_t LANES = 8;
+
+    // constructor and destructor
+    HpwlBatch(const vector<Block*>& blockList, const vector<Net*>& netList);
+    ~HpwlBatch() { }
+
+    // modify methods
+    // take the current positions of the blocks as the packing of lane
+    void load(size_t lane, const vector<Block*>& blockList);
+    // wire[i] = HPWL of lane i, for i < laneNum
+    void eval(size_t laneNum, double* wire) const;
+
+private:
+    vector<uint32_t>    _netStart;  // pins of net i are _pins[_netStart[i], _netStart[i + 1])
+    vector<uint32_t>    _pins;      // block indices of the pins
+    vector<uint32_t>    _fixed;     // min x, max x, min y, max y of the terminals of each net
+    vector<uint32_t>    _x;         // doubled x center of block b in lane i at b * LANES + i
+    vector<uint32_t>    _y;         // doubled y center, same layout
+
+    // private member functions
+    template <size_t N> void evalLanes(size_t laneNum, double* wire) const;
+};
+
+#endif  // HPWLBATCH_H
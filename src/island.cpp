@@ -0,0 +1,58 @@
+/****************************************************************************
+  FileName  [ island.cpp ]
+  Synopsis  [ Implementation of the messages between annealing islands. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.17 ]
+****************************************************************************/
+#include <cstdint>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "island.h"
+using namespace std;
+
+// A closed peer fails the send with EPIPE instead of killing the process
+// with SIGPIPE, so a dead island is dropped like one which has finished.
+static bool writeAll(int fd, const char* buf, size_t size)
+{
+    while (size > 0) {
+        ssize_t n = send(fd, buf, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        buf += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool readAll(int fd, char* buf, size_t size)
+{
+    while (size > 0) {
+        ssize_t n = read(fd, buf, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        buf += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool sendMessage(int fd, const string& data)
+{
+    uint64_t size = data.size();
+    return writeAll(fd, reinterpret_cast<const char*>(&size), sizeof(size)) &&
+           writeAll(fd, data.data(), data.size());
+}
+
+bool recvMessage(int fd, string& data)
+{
+    uint64_t size;
+    if (!readAll(fd, reinterpret_cast<char*>(&size), sizeof(size)) || size > (1ULL << 32))
+        return false;
+    data.resize(size);
+    return size == 0 || readAll(fd, &data[0], size);
+}
@@ -0,0 +1,26 @@
+/****************************************************************************
+  FileName  [ island.h ]
+  Synopsis  [ Define the messages between annealing islands. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.17 ]
+****************************************************************************/
+#ifndef ISLAND_H
+#define ISLAND_H
+
+#include <string>
+using namespace std;
+
+// In the island mode, Floorplanner::floorplanIslands() forks one worker
+// process per island, connected to the parent by a Unix socket pair. Every
+// message is a length-prefixed byte string
+//     <type> <score> <floorplan written by Representation::write()>
+// A worker sends ISLAND_EXCHANGE with the best floorplan of its current run
+// and waits for the reply, the best floorplan of all islands so far in the
+// same format. At the end it sends ISLAND_FINAL with its result.
+enum IslandMessage { ISLAND_EXCHANGE = 1, ISLAND_FINAL = 2 };
+
+// both return false if the other end is gone
+bool sendMessage(int fd, const string& data);
+bool recvMessage(int fd, string& data);
+
+#endif  // ISLAND_H
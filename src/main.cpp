@@ -10,42 +10,262 @@
 #include "floorplanner.h"
 using namespace std;
 
+void usage()
+{
+    cerr << "Usage: ./Floorplanner [options] <alpha> <input block file> " <<
+            "<input net file> <output file>" << endl;
+    cerr << "       ./Floorplanner --verify <alpha> <input block file> " <<
+            "<input net file> <output file>" << endl;
+    cerr << "Options:" << endl;
+    cerr << "  --verify                     check the output file of a run instead of floorplanning" << endl;
+    cerr << "  --engine <bstar|sp>          floorplan representation (default bstar)" << endl;
+    cerr << "  --cost <auto|area|wire|weighted|custom>" << endl;
+    cerr << "                               cost policy (default auto, chosen by alpha)" << endl;
+    cerr << "  --targeted-moves             steer moves by blocks outside the outline" << endl;
+    cerr << "  --windowed-moves             shrink the range of the moves as the temperature drops" << endl;
+    cerr << "  --adaptive-moves             adapt the odds of the move types while annealing" << endl;
+    cerr << "  --compact                    greedily improve the result of every annealing run" << endl;
+    cerr << "  --stop-temp <T>              temperature ending the annealing (default 1)" << endl;
+    cerr << "  --gap <ratio>                stop annealing within this ratio of the lower bound" << endl;
+    cerr << "  --draw <jpg|svg|none>        format of the drawn floorplan (default jpg)" << endl;
+    cerr << "  --cost-cache <n>             entries of the cache of candidate costs, 0 disables" << endl;
+    cerr << "                               (default 65536)" << endl;
+    cerr << "  --speculate <threads>        evaluate the next moves ahead on threads, the result" << endl;
+    cerr << "                               is the same for any number of threads" << endl;
+    cerr << "  --seed <n>                   seed of the random number generator" << endl;
+    cerr << "  --time-limit <sec>           stop annealing after this wall time" << endl;
+    cerr << "  --checkpoint <file>          save the annealing state periodically" << endl;
+    cerr << "  --checkpoint-interval <sec>  seconds between checkpoints (default 60)" << endl;
+    cerr << "  --resume <file>              continue a run from its checkpoint" << endl;
+    cerr << "  --warm-start <file>          start from the placement of a previous output" << endl;
+    cerr << "  --result-cache <dir>         reuse the best floorplans of earlier runs of the circuit" << endl;
+    cerr << "  --init <complete|constructive>" << endl;
+    cerr << "                               initial B*-tree, the complete binary tree in file order" << endl;
+    cerr << "                               or rows of connected blocks (default complete)" << endl;
+    cerr << "  --islands <n>                anneal in n processes exchanging their best floorplans" << endl;
+    cerr << "  --migrate-interval <steps>   temperature steps between two exchanges (default 10)" << endl;
+    cerr << "  --telemetry <file>           write progress samples in JSON lines, may be a FIFO" << endl;
+    cerr << "  --telemetry-interval <sec>   seconds between two samples (default 1)" << endl;
+    exit(1);
+}
+
 int main(int argc, char** argv)
 {
     fstream input_blk, input_net, output;
     double alpha;
+    vector<string> args;
+    string ckptFile, resumeFile, warmFile, telemetryFile, cacheDir;
+    string engine = "bstar", cost = "auto", drawFormat = "jpg", init = "complete";
+    double ckptInterval = 60, timeLimit = 0, telemetryInterval = 1, stopTemp = 1, gap = 0;
+    bool hasSeed = false, targeted = false, windowed = false, adaptive = false, compact = false;
+    bool verify = false;
+    uint64_t seed = 0;
+    size_t islandNum = 0, migrateInterval = 10, cacheSize = 1 << 16, specThreads = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            args.push_back(arg);
+        }
+        else if (arg == "--targeted-moves") {
+            targeted = true;
+        }
+        else if (arg == "--windowed-moves") {
+            windowed = true;
+        }
+        else if (arg == "--adaptive-moves") {
+            adaptive = true;
+        }
+        else if (arg == "--compact") {
+            compact = true;
+        }
+        else if (arg == "--verify") {
+            verify = true;
+        }
+        else if (i + 1 == argc) {
+            usage();
+        }
+        else if (arg == "--engine") {
+            engine = argv[++i];
+            if (engine != "bstar" && engine != "sp")
+                usage();
+        }
+        else if (arg == "--cost") {
+            cost = argv[++i];
+            if (cost != "auto" && cost != "area" && cost != "wire" &&
+                cost != "weighted" && cost != "custom")
+                usage();
+        }
+        else if (arg == "--draw") {
+            drawFormat = argv[++i];
+            if (drawFormat != "jpg" && drawFormat != "svg" && drawFormat != "none")
+                usage();
+        }
+        else if (arg == "--cost-cache") {
+            cacheSize = stoul(argv[++i]);
+        }
+        else if (arg == "--speculate") {
+            specThreads = stoul(argv[++i]);
+            if (specThreads == 0)
+                usage();
+        }
+        else if (arg == "--seed") {
+            seed = stoull(argv[++i]);
+            hasSeed = true;
+        }
+        else if (arg == "--stop-temp") {
+            stopTemp = stod(argv[++i]);
+        }
+        else if (arg == "--gap") {
+            gap = stod(argv[++i]);
+            if (gap < 0)
+                usage();
+        }
+        else if (arg == "--time-limit") {
+            timeLimit = stod(argv[++i]);
+        }
+        else if (arg == "--checkpoint") {
+            ckptFile = argv[++i];
+        }
+        else if (arg == "--checkpoint-interval") {
+            ckptInterval = stod(argv[++i]);
+        }
+        else if (arg == "--resume") {
+            resumeFile = argv[++i];
+        }
+        else if (arg == "--warm-start") {
+            warmFile = argv[++i];
+        }
+        else if (arg == "--result-cache") {
+            cacheDir = argv[++i];
+        }
+        else if (arg == "--init") {
+            init = argv[++i];
+            if (init != "complete" && init != "constructive")
+                usage();
+        }
+        else if (arg == "--islands") {
+            islandNum = stoul(argv[++i]);
+        }
+        else if (arg == "--migrate-interval") {
+            migrateInterval = stoul(argv[++i]);
+            if (migrateInterval == 0)
+                usage();
+        }
+        else if (arg == "--telemetry") {
+            telemetryFile = argv[++i];
+        }
+        else if (arg == "--telemetry-interval") {
+            telemetryInterval = stod(argv[++i]);
+        }
+        else {
+            usage();
+        }
+    }
 
-    if (argc == 5) {
-        alpha = stod(argv[1]);
-        input_blk.open(argv[2], ios::in);
-        input_net.open(argv[3], ios::in);
-        output.open(argv[4], ios::out);
+    if (args.size() == 4) {
+        alpha = stod(args[0]);
+        input_blk.open(args[1], ios::in);
+        input_net.open(args[2], ios::in);
+        // the output file of a run to be verified is read
+        output.open(args[3], verify? ios::in: ios::out);
         if (!input_blk) {
-            cerr << "Cannot open the input file \"" << argv[2]
+            cerr << "Cannot open the input file \"" << args[1]
                  << "\". The program will be terminated..." << endl;
             exit(1);
         }
         if (!input_net) {
-            cerr << "Cannot open the input file \"" << argv[3]
+            cerr << "Cannot open the input file \"" << args[2]
                  << "\". The program will be terminated..." << endl;
             exit(1);
         }
         if (!output) {
-            cerr << "Cannot open the output file \"" << argv[4]
+            cerr << "Cannot open the output file \"" << args[3]
                  << "\". The program will be terminated..." << endl;
             exit(1);
         }
     }
     else {
-        cerr << "Usage: ./Floorplanner <alpha> <input block file> " <<
-                "<input net file> <output file>" << endl;
-        exit(1);
+        usage();
     }
 
     Floorplanner* fp = new Floorplanner(input_blk, input_net);
     fp->setAlpha(alpha);
-    fp->floorplan();
+    if (verify) {
+        if (!fp->verifyResult(output))
+            return 1;
+        cout << "The result \"" << args[3] << "\" is legal." << endl;
+        return 0;
+    }
+    fp->setEngine(engine);
+    fp->setCost(cost);
+    fp->setTargeted(targeted);
+    fp->setWindowed(windowed);
+    fp->setAdaptive(adaptive);
+    fp->setTimeLimit(timeLimit);
+    fp->setCompact(compact);
+    fp->setStopTemp(stopTemp);
+    fp->setGap(gap);
+    fp->setDrawFormat(drawFormat);
+    fp->setCostCache(cacheSize);
+    if (hasSeed)
+        fp->setSeed(seed);
+    if (init == "constructive" && (engine != "bstar" || !warmFile.empty())) {
+        cerr << "The constructive start needs the B*-tree engine and no warm start. "
+             << "The program will be terminated..." << endl;
+        exit(1);
+    }
+    if (init == "constructive")
+        fp->constructInitTree();
+    if (!warmFile.empty()) {
+        fstream input_res(warmFile.c_str(), ios::in);
+        if (!input_res || !fp->readWarmStart(input_res)) {
+            cerr << "Cannot read the previous result \"" << warmFile
+                 << "\". The program will be terminated..." << endl;
+            exit(1);
+        }
+    }
+    if (!cacheDir.empty())
+        fp->setResultCache(cacheDir);
+    // a resumed run keeps checkpointing to the same file by default
+    if (ckptFile.empty())
+        ckptFile = resumeFile;
+    if (!ckptFile.empty())
+        fp->setCheckpoint(ckptFile, ckptInterval);
+    if (!resumeFile.empty())
+        fp->setResume(resumeFile);
+    if (!telemetryFile.empty() && !fp->setTelemetry(telemetryFile, telemetryInterval)) {
+        cerr << "Cannot open the telemetry file \"" << telemetryFile
+             << "\". The program will be terminated..." << endl;
+        exit(1);
+    }
+    if (specThreads > 0 && adaptive) {
+        cerr << "Speculative moves cannot adapt the odds of the move types. "
+             << "The program will be terminated..." << endl;
+        exit(1);
+    }
+#ifdef FP_ALLOC_TRACK
+    if (specThreads > 1) {
+        cerr << "The allocation tracking is not thread-safe, use --speculate 1. "
+             << "The program will be terminated..." << endl;
+        exit(1);
+    }
+#endif
+    if (specThreads > 0)
+        fp->setSpeculate(specThreads);
+    if (islandNum > 0 && !resumeFile.empty()) {
+        cerr << "An island run cannot be resumed. The program will be terminated..." << endl;
+        exit(1);
+    }
+    fp->setMigrateInterval(migrateInterval);
+    if (islandNum > 0)
+        fp->floorplanIslands(islandNum);
+    else
+        fp->floorplan();
     fp->printSummary();
+#ifdef FP_ALLOC_TRACK
+    fp->reportAlloc(cout);
+#endif
     fp->writeResult(output);
 
     return 0;
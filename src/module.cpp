@@ -8,8 +8,8 @@
 #include "module.h"
 using namespace std;
 
-size_t Block::_maxX = 0;
-size_t Block::_maxY = 0;
+thread_local size_t Block::_maxX = 0;
+thread_local size_t Block::_maxY = 0;
 
 /*************************************/
 /*  class Terminal member functions  */
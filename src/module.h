@@ -20,11 +20,11 @@ public:
     ~Terminal()  { }
 
     // basic access methods
-    const string getName()  { return _name; }
-    const size_t getX1()    { return _x1; }
-    const size_t getX2()    { return _x2; }
-    const size_t getY1()    { return _y1; }
-    const size_t getY2()    { return _y2; }
+    string getName()        { return _name; }
+    size_t getX1()          { return _x1; }
+    size_t getX2()          { return _x2; }
+    size_t getY1()          { return _y1; }
+    size_t getY2()          { return _y2; }
 
     // set functions
     void setName(string& name) { _name = name; }
@@ -51,9 +51,9 @@ public:
     ~Block() { }
 
     // basic access methods
-    const size_t getWidth(bool rotate = false)  { return rotate? _h: _w; }
-    const size_t getHeight(bool rotate = false) { return rotate? _w: _h; }
-    const size_t getArea()  { return _h * _w; }
+    size_t getWidth(bool rotate = false)  { return rotate? _h: _w; }
+    size_t getHeight(bool rotate = false) { return rotate? _w: _h; }
+    size_t getArea()        { return _h * _w; }
     static size_t getMaxX() { return _maxX; }
     static size_t getMaxY() { return _maxY; }
 
@@ -67,8 +67,10 @@ public:
 private:
     size_t          _w;         // width of the block
     size_t          _h;         // height of the block
-    static size_t   _maxX;      // maximum x coordinate for all blocks
-    static size_t   _maxY;      // maximum y coordinate for all blocks
+    // per thread, so that the threads of the speculative moves can pack
+    // their own copies of the blocks
+    static thread_local size_t  _maxX;  // maximum x coordinate for all blocks
+    static thread_local size_t  _maxY;  // maximum y coordinate for all blocks
 };
 
 
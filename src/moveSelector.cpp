@@ -0,0 +1,71 @@
+/****************************************************************************
+  FileName  [ moveSelector.cpp ]
+  Synopsis  [ Implementation of the adaptive selector of the move types. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.12 ]
+****************************************************************************/
+#include <cstdint>
+#include "moveSelector.h"
+#include "serialize.h"
+using namespace std;
+
+static const double MIN_PROB = 0.1;         // lower bound of every probability
+static const double LEARN_RATE = 0.1;       // weight of a new reward in the estimate
+
+void MoveSelector::reset(size_t moveNum)
+{
+    _prob.assign(moveNum, (moveNum > 0)? 1.0 / moveNum: 0);
+    _quality.assign(moveNum, 0);
+    return;
+}
+
+size_t MoveSelector::select(Rng& rng) const
+{
+    double r = rng.uniform();
+    for (size_t i = 0, end = _prob.size(); i + 1 < end; ++i) {
+        if (r < _prob[i])
+            return i;
+        r -= _prob[i];
+    }
+    return _prob.size() - 1;
+}
+
+// gain is the relative cost improvement of the move, 0 if it did not improve,
+// and evalNum the number of candidates packed for it
+void MoveSelector::reward(size_t move, double gain, size_t evalNum)
+{
+    _quality[move] += LEARN_RATE * (gain / evalNum - _quality[move]);
+    double sum = 0;
+    for (size_t i = 0, end = _quality.size(); i < end; ++i)
+        sum += _quality[i];
+    // nothing learned yet, keep the probabilities
+    if (sum <= 0)
+        return;
+    double share = 1 - _prob.size() * MIN_PROB;
+    for (size_t i = 0, end = _prob.size(); i < end; ++i)
+        _prob[i] = MIN_PROB + share * _quality[i] / sum;
+    return;
+}
+
+void MoveSelector::write(ostream& os) const
+{
+    writeBinary<uint64_t>(os, _prob.size());
+    for (size_t i = 0, end = _prob.size(); i < end; ++i) {
+        writeBinary(os, _prob[i]);
+        writeBinary(os, _quality[i]);
+    }
+    return;
+}
+
+bool MoveSelector::read(istream& is)
+{
+    uint64_t moveNum;
+    if (!readBinary(is, moveNum) || moveNum > 64)
+        return false;
+    this->reset(moveNum);
+    for (size_t i = 0; i < moveNum; ++i) {
+        if (!readBinary(is, _prob[i]) || !readBinary(is, _quality[i]))
+            return false;
+    }
+    return true;
+}
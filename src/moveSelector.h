@@ -0,0 +1,45 @@
+/****************************************************************************
+  FileName  [ moveSelector.h ]
+  Synopsis  [ Define an adaptive selector of the move types. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.12 ]
+****************************************************************************/
+#ifndef MOVESELECTOR_H
+#define MOVESELECTOR_H
+
+#include <vector>
+#include <iostream>
+#include "rng.h"
+using namespace std;
+
+// Probability matching over the move types of a representation. Every move
+// type keeps a running estimate of its reward, i.e. the relative cost
+// improvement per evaluated candidate, and is selected in proportion to it.
+// Every type keeps at least MIN_PROB so that a type which pays off again
+// later is noticed.
+class MoveSelector
+{
+public:
+    // constructor and destructor
+    MoveSelector(size_t moveNum = 0) { reset(moveNum); }
+    ~MoveSelector() { }
+
+    // basic access methods
+    size_t getMoveNum() const       { return _prob.size(); }
+    double getProb(size_t move) const { return _prob[move]; }
+
+    // modify methods
+    void reset(size_t moveNum);
+    size_t select(Rng& rng) const;
+    void reward(size_t move, double gain, size_t evalNum);
+
+    // saving and restoring the selector
+    void write(ostream& os) const;
+    bool read(istream& is);
+
+private:
+    vector<double>  _prob;      // probability of selecting each move type
+    vector<double>  _quality;   // estimated reward of each move type
+};
+
+#endif  // MOVESELECTOR_H
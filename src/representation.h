@@ -0,0 +1,82 @@
+/****************************************************************************
+  FileName  [ representation.h ]
+  Synopsis  [ Define the interface of a floorplan representation. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.10 ]
+****************************************************************************/
+#ifndef REPRESENTATION_H
+#define REPRESENTATION_H
+
+#include <vector>
+#include <iostream>
+#include "module.h"
+#include "rng.h"
+#include "moveSelector.h"
+using namespace std;
+
+// What a perturbation may know besides the floorplan itself. The hints are
+// filled by Floorplanner from the packing of the current floorplan and are
+// empty when the corresponding move generator is disabled. The perturbation
+// reports the move type it used in _move.
+struct MoveContext
+{
+    MoveContext(Rng* rng = NULL) :
+        _rng(rng), _window(1), _selector(NULL), _move(0), _square(NULL), _class(NULL) { }
+
+    // whether block id looks the same when rotated
+    bool isSquare(size_t id) const  { return _square != NULL && (*_square)[id]; }
+    // whether blocks id1 and id2 may trade places without changing the cost
+    bool isAlike(size_t id1, size_t id2) const {
+        return _class != NULL && (*_class)[id1] == (*_class)[id2];
+    }
+
+    Rng*            _rng;       // random number generator
+    vector<size_t>  _hot;       // blocks sticking out of the outline
+    double          _window;    // fraction of the blocks a move may span, 1 for all
+    MoveSelector*   _selector;  // adaptive choice of the move type, or NULL
+    size_t          _move;      // move type of the last perturbation
+    const vector<bool>*     _square;    // whether each block is square, or NULL
+    const vector<size_t>*   _class;     // equivalence class of each block, or NULL
+};
+
+// A perturbation drops the candidates which cannot change the floorplan, such
+// as rotating a square block, and draws another move if none is left. The
+// last try keeps its candidates, as all the blocks may be alike.
+static const size_t MAX_PERTURB_TRIES = 8;
+
+// applyLocalMove() returns this if local move k does not apply to the
+// floorplan, otherwise what undoLocalMove() needs to revert it
+static const size_t NO_LOCAL_MOVE = (size_t)-1;
+
+// A floorplan representation (B*-tree, sequence pair, ...) encodes the
+// relative positions and orientations of the blocks.
+//
+// Besides the virtual functions below, the annealing driver in Floorplanner
+// is a template over the concrete representation Rep, which must provide
+//     Rep(vector<Block*> blockList)       an initial floorplan
+//     Rep(const Rep&), operator =         candidates are plain values
+//     vector<Rep> perturb(MoveContext& ctx)   neighbors of the floorplan
+//     static const size_t MOVE_NUM        number of move types of perturb()
+//     size_t getLocalMoveNum() const      deterministic local moves, applied in
+//     size_t applyLocalMove(size_t k)     place by the greedy compaction, see
+//     void undoLocalMove(size_t k, size_t undo)   Floorplanner::compact()
+//     uint64_t getHash() const            key of the cost cache, equal for the
+//                                         floorplans packing the same way, 0 if
+//                                         the representation is not hashed
+// so that the candidates of a move need no virtual copies.
+class Representation
+{
+public:
+    virtual ~Representation() { }
+
+    // place the blocks, i.e. set the position of every block in blockList
+    // together with Block::setMaxX() and Block::setMaxY()
+    virtual void pack(vector<Block*>& blockList) = 0;
+
+    // saving and restoring the representation, read() fails unless it is a
+    // valid one of the blockNum blocks
+    virtual void write(ostream& os) const = 0;
+    virtual bool read(istream& is, size_t blockNum) = 0;
+};
+
+#endif  // REPRESENTATION_H
@@ -0,0 +1,151 @@
+/****************************************************************************
+  FileName  [ resultCache.cpp ]
+  Synopsis  [ Implementation of the on-disk cache of the best floorplans. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.20 ]
+****************************************************************************/
+#include <fstream>
+#include <cstdio>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "resultCache.h"
+#include "serialize.h"
+#include "rng.h"
+using namespace std;
+
+// Cache file layout (native byte order):
+// <magic> <version> <circuit hash> <#results>
+// { <engine> <cost> <alpha> <score> <tree> }, the strings prefixed by their size
+static const uint32_t CACHE_MAGIC = 0x43525046;    // "FPRC"
+static const uint32_t CACHE_VERSION = 1;
+
+static void writeString(ostream& os, const string& str)
+{
+    writeBinary<uint32_t>(os, str.size());
+    os.write(str.data(), str.size());
+}
+
+static bool readString(istream& is, string& str)
+{
+    uint32_t size;
+    if (!readBinary(is, size))
+        return false;
+    str.resize(size);
+    return size == 0 || bool(is.read(&str[0], size));
+}
+
+ResultCache::ResultCache(const string& dir, uint64_t circuit) :
+    _dir(dir), _circuit(circuit)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)circuit);
+    _file = _dir + "/" + name;
+}
+
+// FNV-1a, mixed so that close texts spread over all the bits
+uint64_t ResultCache::hashText(const string& text)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0, end = text.size(); i < end; ++i) {
+        hash ^= (unsigned char)text[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return mix64(hash);
+}
+
+bool ResultCache::read(vector<CachedResult>& results) const
+{
+    results.clear();
+    return this->readFile(_file + ".fpr", results) && !results.empty();
+}
+
+bool ResultCache::store(const CachedResult& result, bool replace)
+{
+    if (mkdir(_dir.c_str(), 0777) != 0 && errno != EEXIST)
+        return false;
+    int lock = open((_file + ".lock").c_str(), O_RDWR | O_CREAT, 0666);
+    if (lock < 0)
+        return false;
+    if (flock(lock, LOCK_EX) != 0) {
+        close(lock);
+        return false;
+    }
+
+    // another run may have stored its floorplans since this one started
+    vector<CachedResult> results;
+    this->readFile(_file + ".fpr", results);
+    bool changed = true;
+    size_t i = 0;
+    for (size_t end = results.size(); i < end; ++i) {
+        if (results[i]._engine == result._engine && results[i]._cost == result._cost &&
+            results[i]._alpha == result._alpha)
+            break;
+    }
+    if (i == results.size())
+        results.push_back(result);
+    else if (replace || result._score < results[i]._score)
+        results[i] = result;
+    else
+        changed = false;
+
+    bool ok = true;
+    if (changed) {
+        string tmpFile = _file + ".tmp." + to_string(getpid());
+        ok = this->writeFile(tmpFile, results) &&
+             rename(tmpFile.c_str(), (_file + ".fpr").c_str()) == 0;
+        if (!ok)
+            remove(tmpFile.c_str());
+    }
+    flock(lock, LOCK_UN);
+    close(lock);
+    return ok;
+}
+
+
+// private member functions
+bool ResultCache::readFile(const string& fileName, vector<CachedResult>& results) const
+{
+    fstream in(fileName.c_str(), ios::in | ios::binary);
+    uint32_t magic, version, num;
+    uint64_t circuit;
+    if (!in || !readBinary(in, magic) || !readBinary(in, version))
+        return false;
+    if (magic != CACHE_MAGIC || version != CACHE_VERSION)
+        return false;
+    if (!readBinary(in, circuit) || circuit != _circuit || !readBinary(in, num))
+        return false;
+    for (size_t i = 0; i < num; ++i) {
+        CachedResult result;
+        if (!readString(in, result._engine) || !readString(in, result._cost) ||
+            !readBinary(in, result._alpha) || !readBinary(in, result._score) ||
+            !readString(in, result._tree)) {
+            results.clear();
+            return false;
+        }
+        results.push_back(result);
+    }
+    return true;
+}
+
+bool ResultCache::writeFile(const string& fileName, const vector<CachedResult>& results) const
+{
+    fstream out(fileName.c_str(), ios::out | ios::binary | ios::trunc);
+    if (!out)
+        return false;
+    writeBinary(out, CACHE_MAGIC);
+    writeBinary(out, CACHE_VERSION);
+    writeBinary(out, _circuit);
+    writeBinary<uint32_t>(out, results.size());
+    for (size_t i = 0, end = results.size(); i < end; ++i) {
+        writeString(out, results[i]._engine);
+        writeString(out, results[i]._cost);
+        writeBinary(out, results[i]._alpha);
+        writeBinary(out, results[i]._score);
+        writeString(out, results[i]._tree);
+    }
+    out.close();
+    return bool(out);
+}
@@ -0,0 +1,59 @@
+/****************************************************************************
+  FileName  [ resultCache.h ]
+  Synopsis  [ Define the on-disk cache of the best floorplans across runs. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.20 ]
+****************************************************************************/
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+// A floorplan of the cache and the parameters it was annealed for
+struct CachedResult
+{
+    string      _engine;    // representation, "bstar" or "sp"
+    string      _cost;      // cost policy
+    double      _alpha;     // cost weight of area
+    double      _score;     // reported cost, the lower the better
+    string      _tree;      // the representation as written by write()
+};
+
+// Directory of the best fitting floorplans found so far, shared by the runs
+// on one machine. Every circuit has one file named by the hash of the parsed
+// circuit, with one floorplan per engine, cost policy and alpha. A file is
+// replaced by renaming a complete temporary file over it, so a reader never
+// sees a partial file and needs no lock, while writers take turns on an
+// flock() of a lock file next to it, so that no better floorplan is lost.
+class ResultCache
+{
+public:
+    // constructor and destructor
+    ResultCache(const string& dir, uint64_t circuit);
+    ~ResultCache() { }
+
+    // basic access methods
+    const string& getDir() const    { return _dir; }
+
+    // hash of a canonical text of the circuit
+    static uint64_t hashText(const string& text);
+
+    // all the floorplans of the circuit, false if there are none
+    bool read(vector<CachedResult>& results) const;
+    // keep result unless the floorplan of the same parameters is as good, or
+    // in any case with replace, e.g. if that floorplan cannot be read
+    bool store(const CachedResult& result, bool replace = false);
+
+private:
+    string      _dir;       // cache directory
+    uint64_t    _circuit;   // hash of the circuit
+    string      _file;      // file of the circuit
+
+    bool readFile(const string& fileName, vector<CachedResult>& results) const;
+    bool writeFile(const string& fileName, const vector<CachedResult>& results) const;
+};
+
+#endif  // RESULTCACHE_H
@@ -0,0 +1,50 @@
+/****************************************************************************
+  FileName  [ rng.h ]
+  Synopsis  [ Define a small random number generator with a savable state. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.8 ]
+****************************************************************************/
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+#include <cstddef>
+using namespace std;
+
+// finalizer of splitmix64, a bijective mix of the bits of z
+inline uint64_t mix64(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// splitmix64 generator, the whole state is a single 64-bit word so that
+// it can be written to a checkpoint and restored exactly
+class Rng
+{
+public:
+    // constructor and destructor
+    Rng(uint64_t seed = 0) : _state(seed) { }
+    ~Rng() { }
+
+    // basic access methods
+    uint64_t getState() const       { return _state; }
+
+    // set functions
+    void setState(uint64_t state)   { _state = state; }
+
+    // other member functions
+    uint64_t next() {
+        return mix64(_state += 0x9e3779b97f4a7c15ULL);
+    }
+    // uniform integer in [0, n)
+    size_t operator () (size_t n)   { return next() % n; }
+    // uniform real in [0, 1)
+    double uniform()                { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+    uint64_t    _state;     // state of the generator
+};
+
+#endif  // RNG_H
@@ -0,0 +1,285 @@
+/****************************************************************************
+  FileName  [ sequencePair.cpp ]
+  Synopsis  [ Implementation of the sequence pair. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.10 ]
+****************************************************************************/
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <map>
+#include <algorithm>
+#include "sequencePair.h"
+#include "serialize.h"
+#include "allocTrack.h"
+
+// constructor and destructor
+// The blocks are initially arranged in rows of about sqrt(n) blocks, i.e.
+// G+ lists the rows from top to bottom and G- from bottom to top.
+SequencePair::SequencePair(vector<Block*> blockList)
+{
+    size_t num = blockList.size();
+    size_t cols = ceil(sqrt((double)num));
+    size_t rows = (num + cols - 1) / cols;
+    for (size_t r = 0; r < rows; ++r) {
+        for (size_t c = 0; c < cols && r * cols + c < num; ++c) {
+            _neg.push_back(r * cols + c);
+        }
+    }
+    for (size_t r = rows; r-- > 0; ) {
+        for (size_t c = 0; c < cols && r * cols + c < num; ++c) {
+            _pos.push_back(r * cols + c);
+        }
+    }
+    _orient.resize(num, false);
+}
+
+// member functions
+vector<SequencePair> SequencePair::perturb(MoveContext& ctx)
+{
+    ALLOC_SCOPE("SequencePair::perturb");
+    vector<SequencePair> seqs;
+    for (size_t tries = 1; seqs.empty(); ++tries) {
+        bool filter = (tries < MAX_PERTURB_TRIES);
+        if (ctx._selector != NULL) {
+            ctx._move = ctx._selector->select(*ctx._rng);
+        }
+        else {
+            size_t r = (*ctx._rng)(10);
+            ctx._move = (r < 2)? ROTATE: (r < 6)? SWAP_POS: SWAP_BOTH_ROTATED;
+        }
+        switch (ctx._move) {
+            case ROTATE:
+                this->rotate(seqs, ctx, filter);
+                break;
+            case SWAP_POS:
+                this->swapPos(seqs, ctx);
+                break;
+            default:
+                this->swapBoth(seqs, ctx, ctx._move == SWAP_BOTH_ROTATED, filter);
+                break;
+        }
+    }
+    return seqs;
+}
+
+// Local moves of the greedy compaction, by index k:
+// [0, n)           rotate block k
+// [n, 2n - 1)      swap two neighbors in G+
+// [2n - 1, 3n - 2) swap two neighbors in G-
+// [3n - 2, 4n - 3) swap the blocks of two neighbors in G+ in both sequences
+// Every move is its own inverse.
+size_t SequencePair::getLocalMoveNum() const
+{
+    size_t n = _pos.size();
+    return (n > 0)? 4 * n - 3: 0;
+}
+
+size_t SequencePair::applyLocalMove(size_t k)
+{
+    size_t n = _pos.size();
+    if (k < n) {
+        _orient[k] = !_orient[k];
+        return 0;
+    }
+    k -= n;
+    size_t i = k % (n - 1);
+    if (k < n - 1) {
+        std::swap(_pos[i], _pos[i + 1]);
+    }
+    else if (k < 2 * (n - 1)) {
+        std::swap(_neg[i], _neg[i + 1]);
+    }
+    else {
+        size_t j1 = find(_neg.begin(), _neg.end(), _pos[i]) - _neg.begin();
+        size_t j2 = find(_neg.begin(), _neg.end(), _pos[i + 1]) - _neg.begin();
+        std::swap(_pos[i], _pos[i + 1]);
+        std::swap(_neg[j1], _neg[j2]);
+    }
+    return 0;
+}
+
+void SequencePair::pack(vector<Block*>& blockList)
+{
+    ALLOC_SCOPE("SequencePair::pack");
+    Block::setMaxX(0);
+    Block::setMaxY(0);
+    this->evalLCS(blockList, true);
+    this->evalLCS(blockList, false);
+    return;
+}
+
+// <#blocks> { <G+ id> } { <G- id> } { <orient> }
+void SequencePair::write(ostream& os) const
+{
+    writeBinary<uint32_t>(os, _pos.size());
+    for (size_t i = 0, end = _pos.size(); i < end; ++i) {
+        writeBinary<uint32_t>(os, _pos[i]);
+    }
+    for (size_t i = 0, end = _neg.size(); i < end; ++i) {
+        writeBinary<uint32_t>(os, _neg[i]);
+    }
+    for (size_t i = 0, end = _orient.size(); i < end; ++i) {
+        writeBinary<uint8_t>(os, _orient[i]);
+    }
+    return;
+}
+
+bool SequencePair::read(istream& is, size_t blockNum)
+{
+    uint32_t num;
+    if (!readBinary(is, num) || num == 0 || num != blockNum)
+        return false;
+    _pos.assign(num, 0);
+    _neg.assign(num, 0);
+    _orient.assign(num, false);
+    vector<bool> seenPos(num, false), seenNeg(num, false);
+    for (size_t i = 0; i < num; ++i) {
+        uint32_t id;
+        if (!readBinary(is, id) || id >= num || seenPos[id])
+            return false;
+        _pos[i] = id;
+        seenPos[id] = true;
+    }
+    for (size_t i = 0; i < num; ++i) {
+        uint32_t id;
+        if (!readBinary(is, id) || id >= num || seenNeg[id])
+            return false;
+        _neg[i] = id;
+        seenNeg[id] = true;
+    }
+    for (size_t i = 0; i < num; ++i) {
+        uint8_t orient;
+        if (!readBinary(is, orient))
+            return false;
+        _orient[i] = orient;
+    }
+    return true;
+}
+
+
+// private member functions
+// Weighted LCS of G+ and G- in the manner of FAST-SP (Tang and Wong).
+// The blocks are visited in G+ order (reversed G+ order for y); the start of
+// a block is the longest path over the visited blocks that precede it in G-,
+// which is kept in a map keyed by the G- index whose values increase with
+// the key, so every block costs one lookup and amortized O(1) erasures,
+// O(n log n) in total. A van Emde Boas queue would give O(n log log n), but
+// for the design sizes here the balanced tree is faster in practice.
+void SequencePair::evalLCS(vector<Block*>& blockList, bool horizontal)
+{
+    size_t num = _pos.size();
+    vector<size_t> match(num);
+    for (size_t i = 0; i < num; ++i) {
+        match[_neg[i]] = i;
+    }
+    map<size_t, size_t> bucket;     // G- index -> longest path ending there
+    size_t length = 0;
+    for (size_t k = 0; k < num; ++k) {
+        size_t id = horizontal? _pos[k]: _pos[num - 1 - k];
+        Block* block = blockList[id];
+        size_t p = match[id];
+        size_t size = horizontal? block->getWidth(_orient[id]):
+                                  block->getHeight(_orient[id]);
+
+        // start = value of the predecessor of p
+        size_t start = 0;
+        map<size_t, size_t>::iterator it = bucket.lower_bound(p);
+        if (it != bucket.begin()) {
+            map<size_t, size_t>::iterator prev = it;
+            --prev;
+            start = prev->second;
+        }
+        if (horizontal)
+            block->setPos(start, 0, start + size, 0);
+        else
+            block->setPos(block->getX1(), start, block->getX2(), start + size);
+
+        // insert p and drop the successors dominated by it
+        size_t end = start + size;
+        it = bucket.insert(it, make_pair(p, end));
+        map<size_t, size_t>::iterator next = it;
+        ++next;
+        while (next != bucket.end() && next->second <= end) {
+            bucket.erase(next++);
+        }
+        length = (length > end)? length: end;
+    }
+    if (horizontal)
+        Block::setMaxX(length);
+    else
+        Block::setMaxY(length);
+    return;
+}
+
+void SequencePair::rotate(vector<SequencePair>& seqs, MoveContext& ctx, bool filter)
+{
+    size_t id = this->pickBlock(ctx);
+    if (filter && ctx.isSquare(id))
+        return;
+    seqs.push_back(*(this));
+    seqs.back()._orient[id] = !_orient[id];
+    return;
+}
+
+void SequencePair::swapPos(vector<SequencePair>& seqs, MoveContext& ctx)
+{
+    Rng& rng = *ctx._rng;
+    size_t id1 = 0, id2 = 0;
+    while (id1 == id2) {
+        id1 = this->pickBlock(ctx);
+        id2 = rng(_pos.size());
+    }
+    // swapping in G+ or in G- with equal chance
+    bool neg = rng(2);
+    seqs.push_back(*(this));
+    vector<size_t>& seq = neg? seqs.back()._neg: seqs.back()._pos;
+    std::swap(*find(seq.begin(), seq.end(), id1), *find(seq.begin(), seq.end(), id2));
+    return;
+}
+
+// Rotating a square block gives the candidate without the rotation again,
+// and swapping two alike blocks of the same orientation in both sequences
+// gives this sequence pair again.
+void SequencePair::swapBoth(vector<SequencePair>& seqs, MoveContext& ctx, bool rotated, bool filter)
+{
+    Rng& rng = *ctx._rng;
+    size_t id1 = 0, id2 = 0;
+    while (id1 == id2) {
+        id1 = this->pickBlock(ctx);
+        id2 = rng(_pos.size());
+    }
+    size_t i1 = find(_pos.begin(), _pos.end(), id1) - _pos.begin();
+    size_t i2 = find(_pos.begin(), _pos.end(), id2) - _pos.begin();
+    size_t j1 = find(_neg.begin(), _neg.end(), id1) - _neg.begin();
+    size_t j2 = find(_neg.begin(), _neg.end(), id2) - _neg.begin();
+    bool square1 = filter && ctx.isSquare(id1);
+    bool square2 = filter && ctx.isSquare(id2);
+    bool alike = filter && ctx.isAlike(id1, id2) && (_orient[id1] == _orient[id2] || square1);
+    size_t n = rotated? 2: 1;
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            if ((i == 1 && square1) || (j == 1 && square2) || (i == 0 && j == 0 && alike))
+                continue;
+            seqs.push_back(*(this));
+            SequencePair& seq = seqs.back();
+            std::swap(seq._pos[i1], seq._pos[i2]);
+            std::swap(seq._neg[j1], seq._neg[j2]);
+            if (i == 1)
+                seq._orient[id1] = !seq._orient[id1];
+            if (j == 1)
+                seq._orient[id2] = !seq._orient[id2];
+        }
+    }
+    return;
+}
+
+// Pick a block to be moved. Half of the picks go to the blocks sticking out
+// of the outline, if any.
+size_t SequencePair::pickBlock(MoveContext& ctx)
+{
+    Rng& rng = *ctx._rng;
+    if (!ctx._hot.empty() && rng(2) == 0)
+        return ctx._hot[rng(ctx._hot.size())];
+    return rng(_pos.size());
+}
@@ -0,0 +1,66 @@
+/****************************************************************************
+  FileName  [ sequencePair.h ]
+  Synopsis  [ Define the sequence pair representation. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.10 ]
+****************************************************************************/
+#ifndef SEQUENCEPAIR_H
+#define SEQUENCEPAIR_H
+
+#include <vector>
+#include <iostream>
+#include "module.h"
+#include "rng.h"
+#include "representation.h"
+using namespace std;
+
+// Sequence pair (G+, G-) of block ids:
+// a is left of b  if a is before b in both G+ and G-
+// a is below b    if a is after b in G+ and before b in G-
+class SequencePair : public Representation
+{
+public:
+    // move types of perturb(), SWAP_BOTH_ROTATED also tries the rotations
+    // of the swapped blocks
+    enum Move { ROTATE, SWAP_POS, SWAP_BOTH, SWAP_BOTH_ROTATED };
+    static const size_t MOVE_NUM = 4;
+
+    // constructor and destructor
+    SequencePair() { }
+    SequencePair(vector<Block*> blockList);
+    ~SequencePair() { }
+
+    // perturbing the sequence pair
+    vector<SequencePair> perturb(MoveContext& ctx);
+
+    // local moves for the greedy compaction
+    size_t getLocalMoveNum() const;
+    size_t applyLocalMove(size_t k);
+    void undoLocalMove(size_t k, size_t /*undo*/) { this->applyLocalMove(k); }
+
+    // packing the blocks by weighted longest common subsequence
+    void pack(vector<Block*>& blockList);
+
+    // not hashed, so the candidates are never cached
+    uint64_t getHash() const    { return 0; }
+
+    // saving and restoring the sequence pair
+    void write(ostream& os) const;
+    bool read(istream& is, size_t blockNum);
+
+private:
+    vector<size_t>  _pos;       // G+, block ids
+    vector<size_t>  _neg;       // G-, block ids
+    vector<bool>    _orient;    // orientation of each block (0: origin, 1: rotated)
+
+    // private member functions
+    void evalLCS(vector<Block*>& blockList, bool horizontal);
+
+    // manipulating the sequence pair to get the "neighborhood structures"
+    void rotate(vector<SequencePair>& seqs, MoveContext& ctx, bool filter);
+    void swapPos(vector<SequencePair>& seqs, MoveContext& ctx);
+    void swapBoth(vector<SequencePair>& seqs, MoveContext& ctx, bool rotated, bool filter);
+    size_t pickBlock(MoveContext& ctx);
+};
+
+#endif  // SEQUENCEPAIR_H
@@ -0,0 +1,27 @@
+/****************************************************************************
+  FileName  [ serialize.h ]
+  Synopsis  [ Helpers for reading and writing raw binary values. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.8 ]
+****************************************************************************/
+#ifndef SERIALIZE_H
+#define SERIALIZE_H
+
+#include <iostream>
+using namespace std;
+
+// values are stored in the native byte order, the files are only meant to be
+// read back on the same kind of machine
+template <class T>
+inline void writeBinary(ostream& os, const T& value)
+{
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class T>
+inline bool readBinary(istream& is, T& value)
+{
+    return bool(is.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+#endif  // SERIALIZE_H
@@ -0,0 +1,33 @@
+/****************************************************************************
+  FileName  [ telemetry.cpp ]
+  Synopsis  [ Implementation of the sink of progress samples. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.15 ]
+****************************************************************************/
+#include <cstdio>
+#include "telemetry.h"
+using namespace std;
+
+// Opening a FIFO blocks until a reader opens the other end.
+bool Telemetry::open(const string& fileName, double interval)
+{
+    _out.open(fileName.c_str(), ios::out | ios::trunc);
+    _interval = interval;
+    _last = -interval;
+    return bool(_out);
+}
+
+void Telemetry::write(const TelemetrySample& sample)
+{
+    char line[512];
+    int len = snprintf(line, sizeof(line),
+        "{\"time\": %.3f, \"trial\": %zu, \"T\": %.6g, \"best_cost\": %.10g, "
+        "\"cur_cost\": %.10g, \"accept_rate\": %.4f, \"moves_per_sec\": %.1f, "
+        "\"fit\": %s}\n",
+        sample._time, sample._trial, sample._T, sample._bestCost, sample._curCost,
+        sample._acceptRate, sample._moveRate, sample._fit? "true": "false");
+    _out.write(line, len);
+    _out.flush();
+    _last = sample._time;
+    return;
+}
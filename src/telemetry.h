@@ -0,0 +1,49 @@
+/****************************************************************************
+  FileName  [ telemetry.h ]
+  Synopsis  [ Define a sink of progress samples in JSON lines. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.15 ]
+****************************************************************************/
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <string>
+#include <fstream>
+using namespace std;
+
+// One progress sample of the annealing.
+struct TelemetrySample
+{
+    double      _time;          // wall time since the start of floorplan()
+    size_t      _trial;         // annealing run
+    double      _T;             // temperature
+    double      _bestCost;      // best cost of this run
+    double      _curCost;       // cost of the current floorplan
+    double      _acceptRate;    // accepted moves per move since the last sample
+    double      _moveRate;      // moves per second since the last sample
+    bool        _fit;           // whether a fitting floorplan has been seen
+};
+
+// Writes one JSON object per line to a file or a FIFO. The stream is
+// flushed once per sample, so a reader sees the samples as they come and
+// there is no write in between. The caller asks due() before building a
+// sample, and keeps no Telemetry at all when it is disabled.
+class Telemetry
+{
+public:
+    // constructor and destructor
+    Telemetry() : _interval(1), _last(0) { }
+    ~Telemetry() { }
+
+    bool open(const string& fileName, double interval);
+    // whether a sample should be written at time
+    bool due(double time) const { return time - _last >= _interval; }
+    void write(const TelemetrySample& sample);
+
+private:
+    ofstream    _out;           // file or FIFO
+    double      _interval;      // seconds between two samples
+    double      _last;          // time of the last sample
+};
+
+#endif  // TELEMETRY_H
@@ -0,0 +1,77 @@
+/****************************************************************************
+  FileName  [ workerPool.cpp ]
+  Synopsis  [ Implementation of the pool of threads. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.18 ]
+****************************************************************************/
+#include "workerPool.h"
+using namespace std;
+
+WorkerPool::WorkerPool(size_t threadNum) :
+    _job(NULL), _jobNum(0), _next(0), _batch(0), _busy(0), _quit(false)
+{
+    for (size_t i = 1; i < threadNum; ++i) {
+        _threads.push_back(thread(&WorkerPool::work, this, i));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        lock_guard<mutex> lock(_mutex);
+        _quit = true;
+    }
+    _wake.notify_all();
+    for (size_t i = 0, end = _threads.size(); i < end; ++i) {
+        _threads[i].join();
+    }
+}
+
+void WorkerPool::run(size_t jobNum, const function<void(size_t, size_t)>& job)
+{
+    if (_threads.empty() || jobNum == 1) {
+        for (size_t i = 0; i < jobNum; ++i)
+            job(i, 0);
+        return;
+    }
+    {
+        lock_guard<mutex> lock(_mutex);
+        _job = &job;
+        _jobNum = jobNum;
+        _next = 0;
+        _busy = _threads.size();
+        ++_batch;
+    }
+    _wake.notify_all();
+    this->runJobs(0);
+    unique_lock<mutex> lock(_mutex);
+    _done.wait(lock, [this] { return _busy == 0; });
+    _job = NULL;
+    return;
+}
+
+void WorkerPool::work(size_t thread)
+{
+    size_t batch = 0;
+    while (true) {
+        {
+            unique_lock<mutex> lock(_mutex);
+            _wake.wait(lock, [this, batch] { return _quit || _batch != batch; });
+            if (_quit)
+                return;
+            batch = _batch;
+        }
+        this->runJobs(thread);
+        lock_guard<mutex> lock(_mutex);
+        if (--_busy == 0)
+            _done.notify_one();
+    }
+}
+
+void WorkerPool::runJobs(size_t thread)
+{
+    for (size_t i = _next++; i < _jobNum; i = _next++) {
+        (*_job)(i, thread);
+    }
+    return;
+}
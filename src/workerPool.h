@@ -0,0 +1,52 @@
+/****************************************************************************
+  FileName  [ workerPool.h ]
+  Synopsis  [ Define a pool of threads running batches of jobs. ]
+  Author    [ Fu-Yu Chuang ]
+  Date      [ 2017.5.18 ]
+****************************************************************************/
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+using namespace std;
+
+// A fixed set of threads for the speculative moves of the annealing. run()
+// hands the jobs of one batch out to the threads and returns when all of
+// them are done. The calling thread works on the batch as thread 0, so a
+// pool of one thread runs the jobs in place.
+class WorkerPool
+{
+public:
+    // constructor and destructor
+    WorkerPool(size_t threadNum);
+    ~WorkerPool();
+
+    // basic access methods
+    size_t getThreadNum() const { return _threads.size() + 1; }
+
+    // run job(i, thread) for every i in [0, jobNum)
+    void run(size_t jobNum, const function<void(size_t, size_t)>& job);
+
+private:
+    vector<thread>      _threads;   // threads 1, 2, ...
+    mutex               _mutex;
+    condition_variable  _wake;      // a new batch or the end of the pool
+    condition_variable  _done;      // all threads have left the batch
+    const function<void(size_t, size_t)>* _job;     // job of the batch
+    size_t              _jobNum;    // number of jobs of the batch
+    atomic<size_t>      _next;      // next job to be taken
+    size_t              _batch;     // number of batches started
+    size_t              _busy;      // threads still working on the batch
+    bool                _quit;      // whether the threads should exit
+
+    // private member functions
+    void work(size_t thread);
+    void runJobs(size_t thread);
+};
+
+#endif  // WORKERPOOL_H